@@ -0,0 +1,95 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// The app's components wired together for benchmarks, with a friends list
+// built from plain data. Nothing connects to Discord.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "app/friend.hpp"
+#include "app/message_cache.hpp"
+#include "app/messages.hpp"
+#include "app/names.hpp"
+#include "app/presence.hpp"
+#include "app/search_index.hpp"
+#include "app/voice.hpp"
+#include "discordpp.h"
+#include "ftxui/component/component.hpp"
+#include "ftxui/component/event.hpp"
+
+namespace discord_social_tui {
+
+inline constexpr uint64_t FIRST_FRIEND_ID = 1000;
+
+// Friends numbered from FIRST_FRIEND_ID, with the first one selected and the
+// messages view focused on its input.
+struct Harness {
+  explicit Harness(
+      const size_t friend_count,
+      std::shared_ptr<MessageCache> cache = std::make_shared<MessageCache>())
+      : client(std::make_shared<discordpp::Client>()),
+        presence(std::make_shared<Presence>(client)),
+        voice(std::make_shared<Voice>(client, presence)),
+        names(std::make_shared<Names>()),
+        messages(std::make_shared<Messages>(client, std::move(cache),
+                                            std::make_shared<SearchIndex>(),
+                                            names)),
+        friends(std::make_shared<Friends>(client, messages, voice, names)) {
+    voice->SetFriends(friends);
+    messages->SetFriends(friends);
+    messages->HistoryOpened();
+    friends->SetFriends(MakeFriends(friend_count));
+    friends->SetSelectedIndexByFriendId(FIRST_FRIEND_ID);
+    view = messages->Render();
+    // Move focus from the header down to the input, as a user would.
+    view->OnEvent(ftxui::Event::ArrowDown);
+  }
+
+  [[nodiscard]] std::vector<std::shared_ptr<Friend>> MakeFriends(
+      const size_t count) const {
+    constexpr std::array GROUPS = {
+        discordpp::RelationshipGroupType::OnlinePlayingGame,
+        discordpp::RelationshipGroupType::OnlineElsewhere,
+        discordpp::RelationshipGroupType::Offline,
+    };
+    std::vector<std::shared_ptr<Friend>> result;
+    result.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      result.push_back(std::make_shared<Friend>(
+          FIRST_FRIEND_ID + i, "user" + std::to_string(i),
+          "Friend " + std::to_string(i), discordpp::StatusType::Online,
+          messages, voice, names, GROUPS[i % GROUPS.size()]));
+    }
+    return result;
+  }
+
+  std::shared_ptr<discordpp::Client> client;
+  std::shared_ptr<Presence> presence;
+  std::shared_ptr<Voice> voice;
+  std::shared_ptr<Names> names;
+  std::shared_ptr<Messages> messages;
+  std::shared_ptr<Friends> friends;
+  // The messages view, as App shows it
+  ftxui::Component view;
+};
+
+}  // namespace discord_social_tui
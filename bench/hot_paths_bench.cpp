@@ -0,0 +1,233 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// The paths the UI runs through every frame or on every change, with
+// synthetic data at sizes up to a heavy user's. Escaping log lines is
+// covered by json_escape_bench.cpp. To compare runs, write the results as
+// JSON, e.g. with the discord_social_tui_bench_results target.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+
+#include "app/friend.hpp"
+#include "app/message_cache.hpp"
+#include "app/message_record.hpp"
+#include "app/profile.hpp"
+#include "discordpp.h"
+#include "ftxui/dom/elements.hpp"
+#include "ftxui/screen/screen.hpp"
+#include "harness.hpp"
+
+namespace discord_social_tui {
+
+namespace {
+
+// A typical terminal
+constexpr int WIDTH = 160;
+constexpr int HEIGHT = 50;
+
+// A message cache holding a conversation of the given length with the first
+// friend, alternating between them and us. Its directory is deleted again
+// when the benchmark is done with it.
+class BenchCache {
+ public:
+  explicit BenchCache(const size_t message_count)
+      : directory_(std::filesystem::temp_directory_path() /
+                   "discord_social_tui_bench" /
+                   std::to_string(message_count)),
+        cache_(std::make_shared<MessageCache>()) {
+    constexpr uint64_t OWN_ID = 1;
+    constexpr uint64_t FIRST_MESSAGE_ID = 1'000'000;
+    std::filesystem::remove_all(directory_);
+    cache_->Open(directory_);
+    for (size_t i = 0; i < message_count; ++i) {
+      const bool ours = i % 2 == 1;
+      cache_->Append({
+          .id = FIRST_MESSAGE_ID + i,
+          .conversation_id = FIRST_FRIEND_ID,
+          .author_id = ours ? OWN_ID : FIRST_FRIEND_ID,
+          .sent_timestamp = 1'700'000'000'000 + (i * 1000),
+          .author_name = ours ? "me" : "user0",
+          .content = "Message " + std::to_string(i) +
+                     " with **some** markup and enough words that it has to "
+                     "wrap when the friends list is wide",
+      });
+    }
+  }
+  BenchCache(const BenchCache&) = delete;
+  BenchCache& operator=(const BenchCache&) = delete;
+  ~BenchCache() {
+    std::error_code error;
+    std::filesystem::remove_all(directory_, error);
+  }
+
+  [[nodiscard]] const std::shared_ptr<MessageCache>& get() const {
+    return cache_;
+  }
+
+ private:
+  std::filesystem::path directory_;
+  std::shared_ptr<MessageCache> cache_;
+};
+
+ftxui::Screen MakeScreen() {
+  return ftxui::Screen::Create(ftxui::Dimension::Fixed(WIDTH),
+                               ftxui::Dimension::Fixed(HEIGHT));
+}
+
+// Refresh builds a Friend for every relationship, then merges them into the
+// list. Without a connection the SDK has no relationships, so they are
+// built from plain data here. Nobody has moved, so the list is only updated
+// in place.
+void BM_FriendsRefresh(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  Harness harness(count);
+  for (auto _ : state) {
+    harness.friends->Merge(harness.MakeFriends(count));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetLabel("items are friends");
+}
+BENCHMARK(BM_FriendsRefresh)->RangeMultiplier(10)->Range(10, 10000);
+
+// As above, but the first friend goes between playing and offline every
+// time, so the list is rebuilt.
+void BM_FriendsRefreshRegrouped(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  Harness harness(count);
+  bool offline = false;
+  for (auto _ : state) {
+    auto friends = harness.MakeFriends(count);
+    offline = !offline;
+    if (offline) {
+      const auto& first = friends.front();
+      friends.front() = std::make_shared<Friend>(
+          first->GetId(), first->GetUsername(), first->GetDisplayName(),
+          discordpp::StatusType::Offline, harness.messages, harness.voice,
+          harness.names, discordpp::RelationshipGroupType::Offline);
+    }
+    harness.friends->Merge(friends);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetLabel("items are friends");
+}
+BENCHMARK(BM_FriendsRefreshRegrouped)->RangeMultiplier(10)->Range(10, 10000);
+
+// Every label refresh formats the name of every friend. Sized by the length
+// of the display name.
+void BM_FormattedDisplayName(benchmark::State& state) {
+  Harness harness(0);
+  const auto friend_ = std::make_shared<Friend>(
+      FIRST_FRIEND_ID, "user0",
+      std::string(static_cast<size_t>(state.range(0)), 'x'),
+      discordpp::StatusType::Online, harness.messages, harness.voice,
+      harness.names, discordpp::RelationshipGroupType::OnlineElsewhere);
+  // With an unread count, as the busiest labels have.
+  harness.messages->RestoreUnread(FIRST_FRIEND_ID, 3);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(friend_->GetFormattedDisplayName());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FormattedDisplayName)->RangeMultiplier(8)->Range(8, 512);
+
+// Labels ask for every friend's call, so a list refresh does this many
+// lookups.
+void BM_GetCall(benchmark::State& state) {
+  const auto count = static_cast<uint64_t>(state.range(0));
+  Harness harness(0);
+  for (auto _ : state) {
+    for (uint64_t user_id = FIRST_FRIEND_ID;
+         user_id < FIRST_FRIEND_ID + count; ++user_id) {
+      benchmark::DoNotOptimize(harness.voice->GetCall(user_id));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetLabel("items are lookups");
+}
+BENCHMARK(BM_GetCall)->RangeMultiplier(10)->Range(10, 10000);
+
+// Opening a conversation: its history is loaded from the cache, then laid
+// out and drawn for the first time.
+void BM_OpenConversation(benchmark::State& state) {
+  const BenchCache cache(static_cast<size_t>(state.range(0)));
+  auto screen = MakeScreen();
+  for (auto _ : state) {
+    state.PauseTiming();
+    Harness harness(1, cache.get());
+    harness.messages->SetWidth(WIDTH);
+    state.ResumeTiming();
+
+    ftxui::Render(screen, harness.view->Render());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetLabel("items are messages");
+}
+BENCHMARK(BM_OpenConversation)->RangeMultiplier(10)->Range(10, 10000);
+
+// Drawing an open conversation, as happens every frame.
+void BM_RenderMessages(benchmark::State& state) {
+  const BenchCache cache(static_cast<size_t>(state.range(0)));
+  Harness harness(1, cache.get());
+  harness.messages->SetWidth(WIDTH);
+  auto screen = MakeScreen();
+  for (auto _ : state) {
+    ftxui::Render(screen, harness.view->Render());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel("items are frames");
+}
+BENCHMARK(BM_RenderMessages)->RangeMultiplier(10)->Range(10, 10000);
+
+// Drawing while the divider is dragged, so every message is wrapped again.
+void BM_RenderMessagesResized(benchmark::State& state) {
+  const BenchCache cache(static_cast<size_t>(state.range(0)));
+  Harness harness(1, cache.get());
+  auto screen = MakeScreen();
+  int width = WIDTH;
+  for (auto _ : state) {
+    width = width == WIDTH ? WIDTH - 1 : WIDTH;
+    harness.messages->SetWidth(width);
+    ftxui::Render(screen, harness.view->Render());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel("items are frames");
+}
+BENCHMARK(BM_RenderMessagesResized)->RangeMultiplier(10)->Range(10, 10000);
+
+// Drawing the profile view of the selected friend. Without a connection
+// there are no UserHandles, so the relationship section, which only reads
+// two fields from one, is left out.
+void BM_ProfileRender(benchmark::State& state) {
+  Harness harness(static_cast<size_t>(state.range(0)));
+  const Profile profile(harness.friends);
+  const auto component = profile.Render();
+  auto screen = MakeScreen();
+  for (auto _ : state) {
+    ftxui::Render(screen, component->Render());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel("items are frames");
+}
+BENCHMARK(BM_ProfileRender)->RangeMultiplier(10)->Range(10, 10000);
+
+}  // namespace
+
+}  // namespace discord_social_tui
@@ -0,0 +1,51 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Typing into the message input shouldn't get slower as the friends list
+// grows. BM_Keystroke should stay flat across friend counts, while
+// BM_RebuildFriendsList shows what each keystroke used to pay for.
+
+#include <benchmark/benchmark.h>
+
+#include "harness.hpp"
+
+namespace discord_social_tui {
+
+namespace {
+
+void BM_Keystroke(benchmark::State& state) {
+  Harness harness(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    // Type and delete, so the text doesn't grow between iterations.
+    harness.view->OnEvent(ftxui::Event::Character('a'));
+    harness.view->OnEvent(ftxui::Event::Backspace);
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+  state.SetLabel("items are keystrokes");
+}
+BENCHMARK(BM_Keystroke)->RangeMultiplier(10)->Range(10, 10000);
+
+void BM_RebuildFriendsList(benchmark::State& state) {
+  Harness harness(static_cast<size_t>(state.range(0)));
+  const auto friends = harness.MakeFriends(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    harness.friends->SetFriends(friends);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RebuildFriendsList)->RangeMultiplier(10)->Range(10, 10000);
+
+}  // namespace
+
+}  // namespace discord_social_tui
@@ -0,0 +1,87 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Escaping SDK log lines for the JSON log. BM_LegacyMakeJsonSafe is the
+// regex based version this replaced, kept here as the baseline.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <regex>
+#include <string>
+
+#include "app/json_escape.hpp"
+
+namespace discord_social_tui {
+
+namespace {
+
+std::string LegacyMakeJsonSafe(const std::string& input) {
+  std::string result = input;
+
+  // Remove CR and LF
+  result.erase(std::ranges::remove(result, '\n').begin(), result.end());
+  result.erase(std::ranges::remove(result, '\r').begin(), result.end());
+
+  // Replace backslashes with double backslashes
+  result = std::regex_replace(result, std::regex("\\\\"), "\\\\");
+
+  // Replace double quotes with escaped double quotes
+  result = std::regex_replace(result, std::regex("\""), "\\\"");
+
+  // Replace control characters
+  result = std::regex_replace(result, std::regex("\b"), "\\b");
+  result = std::regex_replace(result, std::regex("\f"), "\\f");
+  result = std::regex_replace(result, std::regex("\t"), "\\t");
+
+  return result;
+}
+
+// Something like a verbose SDK log line, repeated out to the given length.
+std::string LogLine(const size_t length) {
+  static const std::string LINE =
+      R"([RTC] connection state changed: {"state":"connected","id":42} )"
+      "path=C:\\sdk\\rtc\tlatency=12ms\n";
+  std::string line;
+  while (line.size() < length) {
+    line += LINE;
+  }
+  line.resize(length);
+  return line;
+}
+
+void BM_LegacyMakeJsonSafe(benchmark::State& state) {
+  const auto line = LogLine(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LegacyMakeJsonSafe(line));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LegacyMakeJsonSafe)->RangeMultiplier(8)->Range(64, 32768);
+
+void BM_AppendJsonEscaped(benchmark::State& state) {
+  const auto line = LogLine(static_cast<size_t>(state.range(0)));
+  std::string buffer;
+  for (auto _ : state) {
+    buffer.clear();
+    AppendJsonEscaped(buffer, line);
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AppendJsonEscaped)->RangeMultiplier(8)->Range(64, 32768);
+
+}  // namespace
+
+}  // namespace discord_social_tui
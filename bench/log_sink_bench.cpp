@@ -0,0 +1,99 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Writing a typical log line through the JSON text sink the app has always
+// used, against the binary sink. Both write to a temporary directory, and
+// report how many bytes each line cost on disk.
+
+#include <benchmark/benchmark.h>
+#include <spdlog/sinks/basic_file_sink.h>
+#include <spdlog/spdlog.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "app/binary_log.hpp"
+
+namespace discord_social_tui {
+
+namespace {
+
+constexpr size_t SEGMENT_SIZE = 4 * 1024 * 1024;
+// Enough that none are removed while measuring
+constexpr size_t MAX_SEGMENTS = 100000;
+
+std::filesystem::path BenchDirectory() {
+  auto directory =
+      std::filesystem::temp_directory_path() / "discord_social_tui_log_bench";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  return directory;
+}
+
+// Bytes written for a log, across all of its segments.
+uintmax_t DiskUsage(const std::filesystem::path& directory) {
+  uintmax_t total = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+    total += entry.file_size();
+  }
+  return total;
+}
+
+void LogLines(benchmark::State& state, spdlog::logger& logger) {
+  uint64_t message_id = 1380000000000000000;
+  for (auto _ : state) {
+    SPDLOG_LOGGER_INFO(&logger,
+                       "Received {} messages across {} conversations in {}",
+                       3, 1, "215us");
+    SPDLOG_LOGGER_INFO(&logger, "Fetched {} new messages for user {}", 12,
+                       ++message_id);
+  }
+  logger.flush();
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+
+void BM_JsonFileSink(benchmark::State& state) {
+  const auto directory = BenchDirectory();
+  auto sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(
+      (directory / "log").string(), true);
+  sink->set_pattern(R"({"level":"%l","message":"%v",)"
+                    R"("time":"%Y-%m-%d %H:%M:%S.%e","source":"%g"})");
+  spdlog::logger logger("logger", sink);
+
+  LogLines(state, logger);
+  state.counters["bytes_per_line"] = benchmark::Counter(
+      static_cast<double>(DiskUsage(directory)) / (state.iterations() * 2));
+}
+BENCHMARK(BM_JsonFileSink);
+
+void BM_BinaryLogSink(benchmark::State& state) {
+  const auto directory = BenchDirectory();
+  uintmax_t bytes = 0;
+  {
+    auto sink = std::make_shared<BinaryLogSink>(directory / "log",
+                                                SEGMENT_SIZE, MAX_SEGMENTS);
+    spdlog::logger logger("logger", sink);
+    LogLines(state, logger);
+  }
+  // Once finished segments have been compressed
+  bytes = DiskUsage(directory);
+  state.counters["bytes_per_line"] = benchmark::Counter(
+      static_cast<double>(bytes) / (state.iterations() * 2));
+}
+BENCHMARK(BM_BinaryLogSink);
+
+}  // namespace
+
+}  // namespace discord_social_tui
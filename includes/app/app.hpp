@@ -14,13 +14,24 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <future>
 #include <memory>
-#include <mutex>
+#include <optional>
 
 #include "app/buttons.hpp"
+#include "app/connection_manager.hpp"
 #include "app/friend.hpp"
+#include "app/message_cache.hpp"
 #include "app/messages.hpp"
+#include "app/names.hpp"
+#include "app/prefetcher.hpp"
 #include "app/presence.hpp"
+#include "app/search.hpp"
+#include "app/search_index.hpp"
+#include "app/startup_timeline.hpp"
 #include "discordpp.h"
 #include "ftxui/component/component.hpp"
 #include "ftxui/component/screen_interactive.hpp"
@@ -31,9 +42,13 @@ namespace discord_social_tui {
 
 class App {
  public:
-  // Constructor with application ID and client
+  // Constructor with application ID and client. Conversations that haven't
+  // been viewed for compress_after are compressed in memory. Startup phases
+  // are recorded in the timeline.
   App(uint64_t application_id,
-      const std::shared_ptr<discordpp::Client>& client);
+      const std::shared_ptr<discordpp::Client>& client,
+      std::chrono::seconds compress_after,
+      std::shared_ptr<StartupTimeline> timeline);
 
   // Run the application
   int Run();
@@ -42,18 +57,37 @@ class App {
   // Width of the left menu
   static constexpr int LEFT_WIDTH = 20;
 
+  // A user's message history, opened off the UI thread
+  struct PreparedHistory {
+    uint64_t user_id = 0;
+    MessageCache cache;
+    SearchIndex index;
+  };
+
   // Application configuration
   uint64_t application_id_;
 
   // Discord client
   std::shared_ptr<discordpp::Client> client_;
 
+  // Where startup time goes
+  std::shared_ptr<StartupTimeline> timeline_;
+
   // Presence management
   std::shared_ptr<Presence> presence_;
 
   // Voice calling (initialized before friends_)
   std::shared_ptr<Voice> voice_;
 
+  // On-disk message history, opened once we know who is logged in
+  std::shared_ptr<MessageCache> message_cache_;
+
+  // Full-text index over message history, stored alongside the cache
+  std::shared_ptr<SearchIndex> search_index_;
+
+  // Usernames and display names, shared by everything that shows them
+  std::shared_ptr<Names> names_;
+
   // Messages (initialized before friends_)
   std::shared_ptr<Messages> messages_;
 
@@ -67,16 +101,28 @@ class App {
   ftxui::ScreenInteractive screen_;
   bool show_authenticating_modal_;
 
-  // Flag to ensure Ready() is only called once
-  std::once_flag ready_flag_;
   std::unique_ptr<Profile> profile_;
+  std::unique_ptr<Prefetcher> prefetcher_;
+  std::unique_ptr<Search> search_;
   std::shared_ptr<Buttons> buttons_;
 
+  // Authorizing, connecting, and reconnecting after an outage
+  std::unique_ptr<ConnectionManager> connection_;
+
+  // History of the last user, opened while we connect
+  std::future<std::unique_ptr<PreparedHistory>> prepared_history_;
+
   [[nodiscard]] ftxui::Component AuthenticatingModal(
       const ftxui::Component& main) const;
-  void StartStatusChangedCallback();
   void Ready();
-  void Authorize();
+  void Reconnected();
+  void PrepareHistory();
+  void OpenMessageCache();
+  [[nodiscard]] std::filesystem::path HistoryDirectory(uint64_t user_id) const;
+  [[nodiscard]] std::filesystem::path LastUserPath() const;
+  [[nodiscard]] std::optional<uint64_t> LastUserId() const;
+  [[nodiscard]] std::filesystem::path FriendsSnapshotPath(
+      uint64_t user_id) const;
 };
 
 }  // namespace discord_social_tui
\ No newline at end of file
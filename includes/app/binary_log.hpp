@@ -0,0 +1,94 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <spdlog/details/file_helper.h>
+#include <spdlog/sinks/base_sink.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace discord_social_tui {
+
+/// A log sink that writes compact binary records instead of formatted text.
+/// Each record holds the time, level, logger, call site and message, with
+/// loggers and call sites written out once per segment and referred to by
+/// ID after that.
+///
+/// Logs are split into segments named `<base>.<n>.bin`, starting a new one
+/// once a segment reaches `max_segment_size`. Finished segments are
+/// compressed on a background thread to `<base>.<n>.bin.lz`, and only the
+/// newest `max_segments` are kept. Read them back with DecodeBinaryLog().
+class BinaryLogSink final : public spdlog::sinks::base_sink<std::mutex> {
+ public:
+  BinaryLogSink(std::filesystem::path base, size_t max_segment_size,
+                size_t max_segments);
+  ~BinaryLogSink() override;
+
+  BinaryLogSink(const BinaryLogSink&) = delete;
+  BinaryLogSink& operator=(const BinaryLogSink&) = delete;
+  BinaryLogSink(BinaryLogSink&&) = delete;
+  BinaryLogSink& operator=(BinaryLogSink&&) = delete;
+
+ protected:
+  void sink_it_(const spdlog::details::log_msg& msg) override;
+  void flush_() override;
+
+ private:
+  std::filesystem::path base_;
+  size_t max_segment_size_;
+  size_t max_segments_;
+
+  spdlog::details::file_helper file_;
+  uint64_t segment_ = 0;
+  size_t segment_size_ = 0;
+  // Reused for each record
+  spdlog::memory_buf_t buffer_;
+
+  // IDs for what has been written out in the current segment
+  std::map<std::string, uint64_t, std::less<>> loggers_;
+  std::map<std::pair<const char*, int>, uint64_t> call_sites_;
+  int64_t previous_time_ = 0;
+
+  // Finished segments waiting to be compressed
+  std::mutex compress_mutex_;
+  std::condition_variable compress_ready_;
+  std::deque<std::filesystem::path> to_compress_;
+  bool stopping_ = false;
+  std::thread compressor_;
+
+  [[nodiscard]] std::filesystem::path SegmentPath(uint64_t segment) const;
+  void OpenSegment();
+  void Rotate();
+  void RemoveOldSegments() const;
+  void CompressLoop();
+};
+
+/// Decode a binary log segment, compressed or not, writing one JSON object
+/// per line with the text log's fields, plus the line, logger and thread.
+/// Returns false if it can't be read or is corrupt, after writing whatever
+/// could be decoded.
+bool DecodeBinaryLog(const std::filesystem::path& path, std::ostream& out);
+
+}  // namespace discord_social_tui
@@ -17,6 +17,7 @@
 #include <ftxui/component/component_base.hpp>
 #include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "../lib/discord_social_sdk/include/discordpp.h"
@@ -35,6 +36,8 @@ class Buttons {
   /// Call a voice state could potentially have changed, so we can update
   /// buttons.
   void VoiceChanged() const;
+  /// Show the number of unread messages across all conversations.
+  void SetUnreadTotal(uint64_t total);
 
   /// Add a click handler function to be called when DM button is clicked
   void AddDMClickHandler(std::function<void()> handler);
@@ -42,6 +45,9 @@ class Buttons {
   /// Add a click handler function to be called when Profile button is clicked
   void AddProfileClickHandler(std::function<void()> handler);
 
+  /// Add a click handler function to be called when Search button is clicked
+  void AddSearchClickHandler(std::function<void()> handler);
+
   /// Add a click handler function to be called when Voice button is clicked
   void AddVoiceClickHandler(std::function<void()> handler);
 
@@ -55,10 +61,13 @@ class Buttons {
   ftxui::Component disconnect_button_;
   ftxui::Component voice_button_;
   ftxui::Component profile_button_;
+  std::string dm_label_;
   ftxui::Component dm_button_;
+  ftxui::Component search_button_;
   ftxui::Component horizontal_container_;
   std::vector<std::function<void()>> dm_click_handlers_;
   std::vector<std::function<void()>> profile_click_handlers_;
+  std::vector<std::function<void()>> search_click_handlers_;
   std::vector<std::function<void()>> voice_click_handlers_;
   std::vector<std::function<void()>> disconnect_click_handlers_;
 
@@ -68,6 +77,9 @@ class Buttons {
   /// Call all registered Profile click handlers
   void OnProfileClick() const;
 
+  /// Call all registered Search click handlers
+  void OnSearchClick() const;
+
   /// Call all registered Voice click handlers
   void OnVoiceClick() const;
 
@@ -0,0 +1,35 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace discord_social_tui {
+
+/// A small, fast LZ77 codec in the style of LZ4's block format. It only
+/// needs to be good at the repetition in message history (author names,
+/// IDs, quoted text), and to decompress quickly enough to go unnoticed when
+/// a conversation is opened.
+[[nodiscard]] std::vector<std::byte> Compress(std::span<const std::byte> data);
+
+/// Decompress a block produced by Compress(), given its original size.
+/// Returns nothing if the block is corrupt.
+[[nodiscard]] std::optional<std::vector<std::byte>> Decompress(
+    std::span<const std::byte> block, size_t size);
+
+}  // namespace discord_social_tui
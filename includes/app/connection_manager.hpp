@@ -0,0 +1,129 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "app/stats.hpp"
+#include "app/token_store.hpp"
+#include "discordpp.h"
+
+namespace discord_social_tui {
+
+/// Gets the client connected and keeps it that way.
+///
+/// On startup a stored token is used if there is one, refreshing it if it
+/// is about to expire, and the browser is only needed when that fails.
+/// Once connected, the token is refreshed in the background before it
+/// expires, and if the connection is lost it is re-established with
+/// exponential backoff. How long each outage lasts, until the client is
+/// ready again, is recorded.
+class ConnectionManager {
+ public:
+  using Status = discordpp::Client::Status;
+
+  ConnectionManager(std::shared_ptr<discordpp::Client> client,
+                    uint64_t application_id,
+                    std::shared_ptr<TokenStore> token_store);
+
+  /// Authorize and connect.
+  void Start();
+  /// Refresh the token and reconnect when they are due. Call from the main
+  /// loop.
+  void Tick();
+
+  /// Add a callback for every status change
+  void AddStatusChangeHandler(std::function<void(Status status)> handler);
+  /// Add a callback for each time the client becomes ready. `first` is
+  /// false when it is ready again after an outage.
+  void AddReadyHandler(std::function<void(bool first)> handler);
+
+  /// Still waiting to be authorized for the first time?
+  [[nodiscard]] bool IsAuthorizing() const { return authorizing_; }
+  /// Waiting on the user to authorize us in their browser?
+  [[nodiscard]] bool IsWaitingForBrowser() const {
+    return waiting_for_browser_;
+  }
+  /// Time from losing the connection until ready again.
+  [[nodiscard]] const LatencyStats& OutageLatency() const {
+    return outage_latency_;
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // Where the current access token came from
+  enum class TokenSource { Stored, Refreshed, Browser };
+
+  /// Tokens this close to expiring are refreshed
+  static constexpr std::chrono::minutes REFRESH_MARGIN{5};
+  /// Wait before trying a failed background refresh again
+  static constexpr std::chrono::minutes REFRESH_RETRY{1};
+  static constexpr std::chrono::seconds INITIAL_BACKOFF{1};
+  static constexpr std::chrono::seconds MAX_BACKOFF{60};
+  /// Times a token straight from the browser may be turned away before we
+  /// stop sending the user back to it
+  static constexpr uint32_t MAX_BROWSER_ATTEMPTS = 3;
+
+  std::shared_ptr<discordpp::Client> client_;
+  uint64_t application_id_;
+  std::shared_ptr<TokenStore> token_store_;
+
+  std::optional<StoredToken> token_;
+  TokenSource token_source_ = TokenSource::Browser;
+  bool authorizing_ = false;
+  bool waiting_for_browser_ = false;
+  bool refreshing_ = false;
+  // A reconnect came due while a background refresh was in flight, so that
+  // refresh connects once it's done.
+  bool connect_after_refresh_ = false;
+  std::optional<Clock::time_point> refresh_retry_at_;
+  std::optional<Clock::time_point> authorize_at_;
+  uint32_t browser_attempts_ = 0;
+
+  Clock::time_point started_;
+  bool ready_ = false;
+  Status status_ = Status::Disconnected;
+  // Set from losing the connection until ready again
+  std::optional<Clock::time_point> outage_started_;
+  std::optional<Clock::time_point> reconnect_at_;
+  std::chrono::seconds backoff_ = INITIAL_BACKOFF;
+  uint32_t reconnect_attempts_ = 0;
+  LatencyStats outage_latency_;
+
+  std::vector<std::function<void(Status)>> status_change_handlers_;
+  std::vector<std::function<void(bool)>> ready_handlers_;
+
+  void OnStatusChanged(Status status, discordpp::Client::Error error,
+                       int32_t error_detail);
+  void OnReady();
+  void AuthorizeInBrowser();
+  void RefreshToken(bool connect);
+  void OnTokenExchanged(TokenSource source, const std::string& access_token,
+                        const std::string& refresh_token,
+                        discordpp::AuthorizationTokenType token_type,
+                        int32_t expires_in, bool connect);
+  void UseToken(TokenSource source, bool connect);
+  void OnConnectFailed();
+  void ScheduleReconnect();
+};
+
+}  // namespace discord_social_tui
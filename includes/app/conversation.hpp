@@ -0,0 +1,140 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "app/message_record.hpp"
+
+namespace discord_social_tui {
+
+/// The messages in a single conversation, kept in ID order.
+///
+/// Message IDs are snowflakes, so ID order is the order they were sent in.
+/// History pages, live messages and anything delivered twice can be merged
+/// in whatever order they arrive, and duplicates are dropped.
+///
+/// Messages live in stable slots, with a hash index from message ID to
+/// slot, so edits and deletes go straight to the message.
+///
+/// A conversation nobody is looking at can be compressed into a single
+/// block. Anything that changes its messages decompresses it first, but
+/// lookups and iterating are const, so they need an explicit Decompress().
+class Conversation {
+ public:
+  /// Walks the messages in ID order.
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = MessageRecord;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const MessageRecord*;
+    using reference = const MessageRecord&;
+
+    Iterator() = default;
+    Iterator(const std::vector<MessageRecord>* slots,
+             std::vector<uint32_t>::const_iterator position)
+        : slots_(slots), position_(position) {}
+
+    reference operator*() const { return (*slots_)[*position_]; }
+    pointer operator->() const { return &(*slots_)[*position_]; }
+    Iterator& operator++() {
+      ++position_;
+      return *this;
+    }
+    Iterator operator++(int) {
+      auto previous = *this;
+      ++position_;
+      return previous;
+    }
+    bool operator==(const Iterator& other) const {
+      return position_ == other.position_;
+    }
+
+   private:
+    const std::vector<MessageRecord>* slots_ = nullptr;
+    std::vector<uint32_t>::const_iterator position_;
+  };
+
+  /// Add a message, unless we already have it. Returns whether it was added.
+  bool Insert(MessageRecord record);
+  /// Add a batch of messages, e.g. a page of history, skipping any we
+  /// already have. Returns how many were added.
+  size_t Merge(std::vector<MessageRecord> records);
+  /// Replace a message that has been edited. Returns false if we don't have
+  /// it.
+  bool Update(MessageRecord record);
+  /// Remove a deleted message. Returns false if we don't have it.
+  bool Erase(uint64_t message_id);
+
+  /// Always false while compressed.
+  [[nodiscard]] bool Contains(uint64_t message_id) const {
+    return index_.contains(message_id);
+  }
+  /// The message with this ID, or nullptr if we don't have it or it's
+  /// compressed.
+  [[nodiscard]] const MessageRecord* Find(uint64_t message_id) const;
+
+  /// Pack the messages into a compressed block. Returns false if it's
+  /// already compressed, or wouldn't get any smaller.
+  bool Compress();
+  /// Unpack the messages again. Returns false if the block is corrupt, in
+  /// which case the conversation is left empty, for the caller to refill,
+  /// e.g. from the message cache.
+  bool Decompress();
+  [[nodiscard]] bool IsCompressed() const { return compressed_.has_value(); }
+  /// Rough number of bytes of memory held, compressed or not.
+  [[nodiscard]] size_t MemoryUsage() const;
+  /// How much less memory is held than before it was compressed.
+  [[nodiscard]] size_t MemorySaved() const {
+    return compressed_ ? compressed_->memory - MemoryUsage() : 0;
+  }
+
+  [[nodiscard]] Iterator begin() const { return {&slots_, order_.begin()}; }
+  [[nodiscard]] Iterator end() const { return {&slots_, order_.end()}; }
+  [[nodiscard]] size_t size() const {
+    return compressed_ ? compressed_->count : order_.size();
+  }
+  [[nodiscard]] bool empty() const { return size() == 0; }
+
+ private:
+  struct CompressedBlock {
+    std::vector<std::byte> data;
+    // Size of the packed messages before compression
+    size_t size = 0;
+    size_t count = 0;
+    // MemoryUsage() before compression
+    size_t memory = 0;
+  };
+
+  // Message storage. Slots never move, and freed ones are reused.
+  std::vector<MessageRecord> slots_;
+  std::vector<uint32_t> free_slots_;
+  // Slots, sorted by message ID
+  std::vector<uint32_t> order_;
+  // Message ID to slot
+  std::unordered_map<uint64_t, uint32_t> index_;
+  std::optional<CompressedBlock> compressed_;
+
+  uint32_t Allocate(MessageRecord record);
+  [[nodiscard]] std::vector<uint32_t>::iterator Position(uint64_t message_id);
+};
+
+}  // namespace discord_social_tui
@@ -14,12 +14,16 @@
 
 #pragma once
 
+#include <filesystem>
 #include <functional>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
+#include "app/names.hpp"
 #include "discordpp.h"
 #include "ftxui/component/component.hpp"
 #include "ftxui/util/ref.hpp"
@@ -35,30 +39,55 @@ class Friend {
  public:
   explicit Friend(discordpp::UserHandle user_handle,
                   std::shared_ptr<Messages> messages,
-                  std::shared_ptr<Voice> voice,
+                  std::shared_ptr<Voice> voice, std::shared_ptr<Names> names,
                   discordpp::RelationshipGroupType group_type);
-
-  [[nodiscard]] uint64_t GetId() const;
-  [[nodiscard]] std::string GetUsername() const;
-  [[nodiscard]] std::string GetDisplayName() const;
-  [[nodiscard]] discordpp::StatusType GetStatus() const;
+  // A friend built from plain data, without a UserHandle from the SDK.
+  Friend(uint64_t user_id, std::string_view username,
+         std::string_view display_name, discordpp::StatusType status,
+         std::shared_ptr<Messages> messages, std::shared_ptr<Voice> voice,
+         std::shared_ptr<Names> names,
+         discordpp::RelationshipGroupType group_type);
+
+  [[nodiscard]] uint64_t GetId() const { return id_; }
+  // Names are interned, and kept up to date as the user changes them.
+  [[nodiscard]] std::string_view GetUsername() const {
+    return names_->Username(id_);
+  }
+  [[nodiscard]] std::string_view GetDisplayName() const {
+    return names_->DisplayName(id_);
+  }
+  [[nodiscard]] discordpp::StatusType GetStatus() const { return status_; }
   [[nodiscard]] discordpp::RelationshipGroupType GetGroupType() const;
 
   // Get a display string with emoji for the friend's status
   [[nodiscard]] std::string GetFormattedDisplayName() const;
 
+  // The formatted display name, as shown in the friends list. Menu entries
+  // point at it, so refreshing it updates the entry in place.
+  [[nodiscard]] const std::string& GetLabel() const { return label_; }
+  // Recompute the label, e.g. when unread messages or a call changed.
+  void RefreshLabel();
+  // Take on the latest from the SDK, e.g. a new status, from a fresh
+  // Friend for the same user. Returns whether the label changed.
+  bool Update(const Friend& latest);
+
   // Implicit conversion to ftxui::ConstStringRef
-  operator ftxui::ConstStringRef() const { return GetFormattedDisplayName(); }
+  operator ftxui::ConstStringRef() const { return &label_; }
 
-  // Access to the underlying UserHandle
-  [[nodiscard]] const discordpp::UserHandle& GetUserHandle() const {
+  // Access to the underlying UserHandle, if built from one
+  [[nodiscard]] const std::optional<discordpp::UserHandle>& GetUserHandle()
+      const {
     return user_handle_;
   }
 
  private:
-  discordpp::UserHandle user_handle_;
+  std::optional<discordpp::UserHandle> user_handle_;
+  uint64_t id_;
+  discordpp::StatusType status_;
+  std::string label_;
   std::shared_ptr<Messages> messages_;
   std::shared_ptr<Voice> voice_;
+  std::shared_ptr<Names> names_;
   std::vector<discordpp::MessageHandle> message_handlers_;
   discordpp::RelationshipGroupType group_type_;
 };
@@ -67,7 +96,8 @@ class Friend {
 class Friends final {
  public:
   Friends(std::shared_ptr<discordpp::Client> client,
-          std::shared_ptr<Messages> messages, std::shared_ptr<Voice> voice);
+          std::shared_ptr<Messages> messages, std::shared_ptr<Voice> voice,
+          std::shared_ptr<Names> names);
 
   // Get a friend by index
   [[nodiscard]] std::optional<std::shared_ptr<Friend>> GetFriendAt(
@@ -75,7 +105,7 @@ class Friends final {
 
   // Get a friend by ID
   [[nodiscard]] std::optional<std::shared_ptr<Friend>> GetFriendById(
-      uint64_t user_id);
+      uint64_t user_id) const;
 
   // Get the number of friends
   [[nodiscard]] size_t size() const { return friends_.size(); }
@@ -83,6 +113,9 @@ class Friends final {
   // Set the selected index to the friend with the given user ID
   void SetSelectedIndexByFriendId(uint64_t user_id);
 
+  // Get the index of the selected entry
+  [[nodiscard]] size_t GetSelectedIndex() const { return selected_index_; }
+
   // Get the currently selected friend
   [[nodiscard]] std::optional<std::shared_ptr<Friend>> GetSelectedFriend()
       const {
@@ -92,8 +125,24 @@ class Friends final {
   // Render the friends list as a menu component
   [[nodiscard]] ftxui::Component Render();
 
-  // Refresh the menu component when friends list changes
+  // Bring the list up to date with the SDK.
   void Refresh();
+  // Bring the list in line with `latest`, in group order. Friends already
+  // in the list are updated in place, and it's only rebuilt if anyone was
+  // added, removed or moved to another group.
+  void Merge(const std::vector<std::shared_ptr<Friend>>& latest);
+  // Replace the friends list, grouping friends under their headers
+  void SetFriends(const std::vector<std::shared_ptr<Friend>>& friends);
+  // Recompute every friend's label, without rebuilding the list
+  void RefreshLabels() const;
+
+  // Show the list as it was at the end of the last run, until the live one
+  // arrives. Returns whether there was one to show.
+  bool LoadSnapshot(const std::filesystem::path& path);
+  // Save the list for the next run to start with.
+  void SaveSnapshot(const std::filesystem::path& path) const;
+  // Is the list still the one from the last run?
+  [[nodiscard]] bool IsStale() const { return stale_; }
 
   // Add a callback for when the selection changes
   void AddSelectionChangeHandler(std::function<void()> handler);
@@ -102,6 +151,8 @@ class Friends final {
 
  private:
   std::vector<std::optional<std::shared_ptr<Friend>>> friends_;
+  // Friend ID to index in friends_
+  std::unordered_map<uint64_t, size_t> friend_indexes_;
   int selected_index_ = 0;       // Default to first item
   int last_selected_index_ = 0;  // Track last selection for change detection
   ftxui::Component
@@ -112,6 +163,8 @@ class Friends final {
   std::shared_ptr<discordpp::Client> client_;
   std::shared_ptr<Messages> messages_;
   std::shared_ptr<Voice> voice_;
+  std::shared_ptr<Names> names_;
+  bool stale_ = false;
 
   // Notify all selection change handlers
   void NotifySelectionChanged() const;
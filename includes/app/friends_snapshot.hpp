@@ -0,0 +1,72 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "discordpp.h"
+
+namespace discord_social_tui {
+
+/// The friends list as it was at the end of the last run, so it can be
+/// shown straight away on the next, before the SDK is ready.
+///
+/// The file is a header, a table of fixed-size entries, then the names
+/// they point into. It is memory-mapped and read in place, so opening it
+/// costs a page fault or two rather than a parse.
+class FriendsSnapshot {
+ public:
+  struct Entry {
+    uint64_t user_id = 0;
+    std::string_view username;
+    std::string_view display_name;
+    discordpp::StatusType status = discordpp::StatusType::Offline;
+    discordpp::RelationshipGroupType group_type =
+        discordpp::RelationshipGroupType::Offline;
+    uint32_t unread = 0;
+  };
+
+  /// Map a snapshot, if there is a valid one. Names point into the mapping,
+  /// so only live as long as the snapshot does.
+  [[nodiscard]] static std::optional<FriendsSnapshot> Open(
+      const std::filesystem::path& path);
+  /// Write a snapshot, replacing any that is already there.
+  static bool Save(const std::filesystem::path& path,
+                   std::span<const Entry> entries);
+
+  ~FriendsSnapshot();
+  FriendsSnapshot(const FriendsSnapshot&) = delete;
+  FriendsSnapshot& operator=(const FriendsSnapshot&) = delete;
+  FriendsSnapshot(FriendsSnapshot&& other) noexcept;
+  FriendsSnapshot& operator=(FriendsSnapshot&& other) noexcept;
+
+  [[nodiscard]] size_t size() const { return count_; }
+  [[nodiscard]] Entry operator[](size_t index) const;
+
+ private:
+  FriendsSnapshot(const std::byte* map, size_t size, size_t count);
+  void Unmap();
+
+  const std::byte* map_ = nullptr;
+  size_t size_ = 0;
+  size_t count_ = 0;
+};
+
+}  // namespace discord_social_tui
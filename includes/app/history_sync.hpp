@@ -0,0 +1,121 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "app/message_cache.hpp"
+#include "app/stats.hpp"
+#include "discordpp.h"
+
+namespace discord_social_tui {
+
+/// Keeps message history up to date with as few requests as possible.
+///
+/// The newest message ID seen in each conversation is tracked (seeded from
+/// the message cache, which only ever holds history contiguous with what
+/// was synced). When syncing, the SDK's message summaries tell us
+/// which conversations have anything newer, and only those are fetched,
+/// starting with a small page that grows until it overlaps what we already
+/// have. The SDK only returns the newest messages, so a conversation more
+/// than MAX_LIMIT behind can't be caught up; it is left unsynced, and its
+/// newest messages are shown without being cached.
+class HistorySync {
+ public:
+  /// Called with the messages a conversation was missing, oldest first.
+  /// `contiguous` is false when there were too many to reach back to what
+  /// we already had, so there's a gap before them that must not be cached.
+  using MergeHandler = std::function<void(
+      uint64_t user_id, const std::vector<discordpp::MessageHandle>& messages,
+      bool contiguous)>;
+
+  /// Background syncs wait behind anything the user is waiting on.
+  enum class Priority { Foreground, Background };
+
+  HistorySync(std::shared_ptr<discordpp::Client> client,
+              std::shared_ptr<MessageCache> cache, MergeHandler on_merge);
+
+  /// Bring every conversation we already have history for up to date.
+  /// Used on startup and after reconnecting.
+  void SyncAll();
+  /// Fetch whatever is missing from a single conversation.
+  void Sync(uint64_t user_id, Priority priority = Priority::Foreground);
+  /// Is a sync of this conversation queued or in flight?
+  [[nodiscard]] bool IsPending(uint64_t user_id) const;
+  /// Has this conversation been synced since we last (re)connected? Only
+  /// then do live messages follow on from the history we have.
+  [[nodiscard]] bool IsSynced(uint64_t user_id) const;
+  /// Treat a conversation as out of date until it is synced again, e.g.
+  /// when its history has to be reloaded.
+  void Unsync(uint64_t user_id);
+  /// Record that a live message has been seen. Returns whether it follows
+  /// on from the synced history, and so may be cached. Until a
+  /// conversation is synced it is ignored, so the history in between
+  /// isn't skipped; the next sync fetches it along with everything else.
+  [[nodiscard]] bool Observe(uint64_t user_id, uint64_t message_id);
+
+  /// How long the most recent sync of this conversation took.
+  [[nodiscard]] std::optional<std::chrono::nanoseconds> LastLatency(
+      uint64_t user_id) const;
+  /// Sync latency across all conversations.
+  [[nodiscard]] const LatencyStats& Latency() const { return latency_; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  /// Page size when we have nothing locally.
+  static constexpr int32_t FULL_LIMIT = 50;
+  /// First page size when we only need to catch up.
+  static constexpr int32_t DELTA_LIMIT = 10;
+  /// Page size we stop growing at. If we still haven't overlapped, the gap
+  /// can't be closed.
+  static constexpr int32_t MAX_LIMIT = 200;
+  static constexpr int32_t LIMIT_GROWTH = 4;
+  /// Conversations fetched at once, so a reconnect doesn't flood the API.
+  static constexpr size_t MAX_IN_FLIGHT = 4;
+
+  std::shared_ptr<discordpp::Client> client_;
+  std::shared_ptr<MessageCache> cache_;
+  MergeHandler on_merge_;
+
+  std::unordered_map<uint64_t, uint64_t> last_seen_;
+  std::deque<uint64_t> queue_;
+  // Conversations that are queued or in flight
+  std::unordered_set<uint64_t> pending_;
+  std::unordered_set<uint64_t> in_flight_;
+  std::unordered_set<uint64_t> synced_;
+
+  std::unordered_map<uint64_t, std::chrono::nanoseconds> last_latency_;
+  LatencyStats latency_;
+
+  // Progress of the current SyncAll(), for logging once it completes
+  std::optional<Clock::time_point> sync_all_started_;
+  size_t sync_all_messages_ = 0;
+
+  [[nodiscard]] uint64_t LastSeen(uint64_t user_id) const;
+  void Pump();
+  void Fetch(uint64_t user_id, int32_t limit, Clock::time_point started);
+  void Finish(uint64_t user_id, Clock::time_point started, bool synced);
+};
+
+}  // namespace discord_social_tui
@@ -0,0 +1,31 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace discord_social_tui {
+
+/// Append text to a JSON string literal (without the quotes), escaping
+/// quotes, backslashes and every control character as RFC 8259 requires.
+///
+/// Runs of text that need no escaping are found 16 or 32 bytes at a time
+/// with SSE2 or AVX2 where the build targets them, and copied in one go.
+/// Appending to a buffer that is cleared and reused avoids allocating for
+/// each string.
+void AppendJsonEscaped(std::string& out, std::string_view text);
+
+}  // namespace discord_social_tui
@@ -0,0 +1,105 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace discord_social_tui {
+
+/// A logger for one part of the app, sharing the default logger's sinks.
+/// Each has its own level, so one subsystem can be turned up without the
+/// rest, e.g. SPDLOG_LEVEL=info,messages=debug. Call after logging is
+/// configured.
+std::shared_ptr<spdlog::logger> Logger(const std::string& subsystem);
+
+/// Decides which messages from a busy call site get logged. Use through
+/// LOG_EVERY_N and LOG_PER_SECOND, which give each call site its own.
+class LogLimiter {
+ public:
+  /// Let through one in every `every_n` messages, and at most `per_second`
+  /// a second. Zero turns either limit off.
+  LogLimiter(uint32_t every_n, uint32_t per_second);
+
+  /// Empty if this message should be dropped, otherwise how many were
+  /// dropped since the last one let through.
+  [[nodiscard]] std::optional<uint64_t> Admit();
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  std::mutex mutex_;
+  uint32_t every_n_;
+  uint32_t per_second_;
+  uint64_t seen_ = 0;
+  uint64_t suppressed_ = 0;
+  // Token bucket for the per second limit, allowing bursts of up to a
+  // second's worth.
+  double tokens_;
+  Clock::time_point refilled_;
+};
+
+/// Log a message that got through a LogLimiter, noting how many before it
+/// didn't.
+template <typename... Args>
+void LogLimited(spdlog::logger& logger, const spdlog::source_loc& location,
+                const spdlog::level::level_enum level,
+                const uint64_t suppressed,
+                spdlog::format_string_t<Args...> format, Args&&... args) {
+  if (suppressed == 0) {
+    logger.log(location, level, format, std::forward<Args>(args)...);
+    return;
+  }
+  const auto message = spdlog::fmt_lib::vformat(
+      format, spdlog::fmt_lib::make_format_args(args...));
+  logger.log(location, level, "{} ({} similar messages suppressed)", message,
+             suppressed);
+}
+
+}  // namespace discord_social_tui
+
+/// Log through `logger` (a pointer) at `level`, one in every `every_n` and
+/// at most `per_second` a second. Like the SPDLOG_LOGGER_* macros, call
+/// sites below SPDLOG_ACTIVE_LEVEL are compiled out.
+#define LOG_LIMITED(logger, level, every_n, per_second, ...)                \
+  do {                                                                      \
+    if constexpr ((level) >= SPDLOG_ACTIVE_LEVEL) {                         \
+      if ((logger)->should_log(level)) {                                    \
+        static ::discord_social_tui::LogLimiter log_limiter((every_n),      \
+                                                            (per_second));  \
+        if (const auto suppressed = log_limiter.Admit()) {                  \
+          ::discord_social_tui::LogLimited(                                 \
+              *(logger),                                                    \
+              spdlog::source_loc{__FILE__, __LINE__, SPDLOG_FUNCTION},      \
+              (level), *suppressed, __VA_ARGS__);                           \
+        }                                                                   \
+      }                                                                     \
+    }                                                                       \
+  } while (false)
+
+/// Log one in every `n` messages from this call site.
+#define LOG_EVERY_N(logger, level, n, ...) \
+  LOG_LIMITED(logger, level, n, 0, __VA_ARGS__)
+
+/// Log at most `n` messages a second from this call site.
+#define LOG_PER_SECOND(logger, level, n, ...) \
+  LOG_LIMITED(logger, level, 0, n, __VA_ARGS__)
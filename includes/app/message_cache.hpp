@@ -0,0 +1,128 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "app/message_record.hpp"
+
+namespace discord_social_tui {
+
+/// Persistent on-disk cache of direct messages.
+///
+/// Messages are appended to a log of numbered segment files. Each record is
+/// length-prefixed and checksummed, so a torn write from a crash is detected
+/// and truncated away the next time the cache is opened. Segments are
+/// memory-mapped for reads, and an in-memory index of per-conversation
+/// offsets means loading a conversation never scans unrelated records.
+class MessageCache {
+ public:
+  MessageCache() = default;
+  ~MessageCache();
+
+  MessageCache(const MessageCache&) = delete;
+  MessageCache& operator=(const MessageCache&) = delete;
+  // Moving hands over the open segments, e.g. from a cache opened on
+  // another thread.
+  MessageCache(MessageCache&& other) noexcept;
+  MessageCache& operator=(MessageCache&& other) noexcept;
+
+  /// Open (or create) the cache in the given directory, recovering from any
+  /// partially written records and compacting old segments if there are too
+  /// many. Returns false if the cache could not be opened, in which case all
+  /// other operations are no-ops.
+  bool Open(const std::filesystem::path& directory);
+  /// Flush and close all segments.
+  void Close();
+  [[nodiscard]] bool IsOpen() const { return active_fd_ >= 0; }
+
+  /// Is this message already stored?
+  [[nodiscard]] bool Contains(uint64_t message_id) const;
+  /// Append a message to the log. Messages already stored are ignored.
+  void Append(const MessageRecord& record);
+  /// Store a new copy of a message that has been edited, if we have it.
+  void Update(const MessageRecord& record);
+  /// Forget a message that has been deleted.
+  void Remove(uint64_t message_id);
+  /// ID of the newest stored message in a conversation, or 0 if there are
+  /// none.
+  [[nodiscard]] uint64_t NewestMessageId(uint64_t conversation_id) const;
+  /// All stored messages for a conversation, ordered by message ID.
+  [[nodiscard]] std::vector<MessageRecord> Load(uint64_t conversation_id);
+  /// A single stored message.
+  [[nodiscard]] std::optional<MessageRecord> Get(uint64_t message_id);
+  /// Visit every stored message whose ID passes the filter. Messages that
+  /// are filtered out are never read from disk.
+  void ForEach(const std::function<bool(uint64_t message_id)>& filter,
+               const std::function<void(const MessageRecord&)>& visitor);
+
+  /// Rewrite all sealed segments into one, dropping superseded records.
+  /// Safe to crash part way through: deleted messages never come back.
+  /// Returns false if they were left as they were, e.g. because the
+  /// compacted segment couldn't be written.
+  bool Compact();
+
+ private:
+  /// Segments larger than this are sealed and a new one is started.
+  static constexpr size_t MAX_SEGMENT_SIZE = 8 * 1024 * 1024;
+  /// Compact on open once this many sealed segments have built up.
+  static constexpr size_t COMPACT_THRESHOLD = 4;
+
+  struct Segment {
+    uint32_t number = 0;
+    std::filesystem::path path;
+    size_t size = 0;
+    const std::byte* map = nullptr;
+    size_t mapped_size = 0;
+  };
+
+  /// Where a record lives: which segment, and the offset within it. A
+  /// compacted segment can grow past 4GiB, so offsets are 64 bits.
+  struct Location {
+    uint32_t segment = 0;
+    uint64_t offset = 0;
+
+    bool operator==(const Location&) const = default;
+  };
+
+  std::filesystem::path directory_;
+  std::vector<Segment> segments_;
+  int active_fd_ = -1;
+  std::unordered_map<uint64_t, std::vector<Location>> conversations_;
+  std::unordered_map<uint64_t, Location> messages_;
+  std::unordered_map<uint64_t, uint64_t> newest_;
+
+  /// Open without compacting, so compaction can reopen the cache.
+  bool OpenSegments(const std::filesystem::path& directory);
+  bool ScanSegment(size_t segment_index);
+  /// Append an encoded record, indexing it if it holds a message.
+  void Write(const std::vector<std::byte>& encoded,
+             const MessageRecord* record);
+  bool StartSegment(uint32_t number);
+  static bool WriteAll(int file_descriptor, const std::vector<std::byte>& data);
+  const std::byte* Map(Segment& segment, size_t minimum_size);
+  static void Unmap(Segment& segment);
+  [[nodiscard]] std::optional<MessageRecord> ReadAt(const Location& location);
+  void Index(const MessageRecord& record, const Location& location);
+  [[nodiscard]] std::filesystem::path SegmentPath(uint32_t number) const;
+};
+
+}  // namespace discord_social_tui
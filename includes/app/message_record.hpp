@@ -0,0 +1,43 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "app/rich_text.hpp"
+
+namespace discord_social_tui {
+
+/// A plain copy of a direct message, detached from the SDK's MessageHandle so
+/// it can be stored on disk and rendered before the SDK is connected.
+struct MessageRecord {
+  uint64_t id = 0;
+  /// The other user in the DM, which is what conversations are keyed by.
+  uint64_t conversation_id = 0;
+  uint64_t author_id = 0;
+  uint64_t sent_timestamp = 0;
+  std::string author_name;
+  std::string content;
+  /// Content and author name have been made safe to draw. Not stored on
+  /// disk, so records from the cache are checked again when loaded.
+  bool sanitized = false;
+  /// Markup in the content, parsed along with sanitizing it. Empty for
+  /// plain text.
+  std::vector<TextSpan> spans{};
+};
+
+}  // namespace discord_social_tui
@@ -14,12 +14,27 @@
 
 #pragma once
 
+#include <chrono>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "app/conversation.hpp"
 #include "app/friend.hpp"
+#include "app/history_sync.hpp"
+#include "app/message_cache.hpp"
+#include "app/message_record.hpp"
+#include "app/names.hpp"
+#include "app/outbound_queue.hpp"
+#include "app/search_index.hpp"
+#include "app/stats.hpp"
+#include "app/text_layout.hpp"
+#include "app/unread_counts.hpp"
 #include "discordpp.h"
 #include "ftxui/component/component.hpp"
 
@@ -27,40 +42,171 @@ namespace discord_social_tui {
 
 class Messages {
  public:
-  explicit Messages(const std::shared_ptr<discordpp::Client>& client);
+  Messages(const std::shared_ptr<discordpp::Client>& client,
+           std::shared_ptr<MessageCache> cache,
+           std::shared_ptr<SearchIndex> search_index,
+           std::shared_ptr<Names> names);
 
   /// Set the Friends reference (used to break circular dependency)
   void SetFriends(const std::shared_ptr<Friends>& friends);
 
   void Run();
-  /// Resets the selected user has unread messages.
+  /// Catch up on history missed while we were offline. Called on startup and
+  /// whenever the SDK reconnects.
+  void SyncHistory();
+  /// Conversations aren't loaded until the current user's cache is open,
+  /// so none miss what's in it. Called once it is.
+  void HistoryOpened();
+  /// Outgoing messages are held while disconnected, and sent on reconnect.
+  void SetConnected(bool connected);
+  /// Ingest messages received since the last tick, and retry sends that
+  /// are due. Called from the main loop.
+  void Tick();
+  /// Messages received but not yet ingested.
+  [[nodiscard]] size_t IncomingCount() const { return incoming_.size(); }
+  /// Marks everything in the selected conversation as read.
   void ResetSelectedUnreadMessages();
+  /// Carry an unread count over from the last run.
+  void RestoreUnread(uint64_t user_id, uint32_t count);
   // Does this user have any unread messages?
   bool HasUnreadMessages(uint64_t user_id) const;
+  // How many unread messages from this user?
+  [[nodiscard]] uint32_t UnreadCount(uint64_t user_id) const;
+  // How many unread messages across all conversations?
+  [[nodiscard]] uint64_t UnreadTotal() const { return unread_.Total(); }
+
+  /// Compress conversations that haven't been viewed for this long. Zero
+  /// keeps everything uncompressed.
+  void SetCompressAfter(std::chrono::seconds idle);
+
+  /// Set how many columns the message list has to wrap into. Cached
+  /// layouts are only thrown away when this changes.
+  void SetWidth(int width);
+
+  /// Scroll to and highlight a message when its conversation is shown.
+  void FocusMessage(uint64_t message_id);
+
+  /// Load a conversation's history at low priority, ahead of it being opened.
+  void Prefetch(uint64_t user_id);
+  /// Is this conversation's history in memory and up to date?
+  [[nodiscard]] bool IsLoaded(uint64_t user_id) const;
+  /// Is history for this conversation still being fetched?
+  [[nodiscard]] bool IsLoading(uint64_t user_id) const;
+  /// Has the user typed into the message input within the last moment?
+  [[nodiscard]] bool IsTyping() const;
+  /// Conversations with unread messages.
+  [[nodiscard]] std::vector<uint64_t> UnreadConversations() const;
+  /// Conversations with recent activity, most recent first.
+  [[nodiscard]] const std::deque<uint64_t>& RecentConversations() const {
+    return recent_conversations_;
+  }
+  /// How often a conversation was already loaded when it was opened.
+  [[nodiscard]] double OpenHitRate() const;
+  /// Log how often opened conversations were already loaded, and how fast
+  /// incoming messages were ingested.
+  void LogStats() const;
 
   /// Render the messages UI component
   [[nodiscard]] ftxui::Component Render();
 
-  // Add a callback for when incoming unread messages state changes
-  void AddUnreadChangeHandler(std::function<void()> handler);
+  // Add a callback for when unread counts change, with the conversations
+  // that changed
+  void AddUnreadChangeHandler(
+      std::function<void(std::span<const uint64_t> user_ids)> handler);
 
  private:
   std::shared_ptr<discordpp::Client> client_;
   std::shared_ptr<Friends> friends_;
+  std::shared_ptr<MessageCache> cache_;
+  std::shared_ptr<SearchIndex> search_index_;
+  std::shared_ptr<Names> names_;
+  /// How long after a keystroke the user still counts as typing.
+  static constexpr std::chrono::seconds TYPING_TIMEOUT{1};
+  /// How many recently active conversations to remember.
+  static constexpr size_t MAX_RECENT_CONVERSATIONS = 10;
+  /// How often to look for idle conversations to compress.
+  static constexpr std::chrono::seconds COMPRESS_INTERVAL{10};
+  /// Rendered rows kept before the layout cache starts over.
+  static constexpr size_t MAX_RENDERED_ROWS = 20000;
+
+  std::unique_ptr<HistorySync> history_sync_;
+  bool history_open_ = false;
+  std::unique_ptr<OutboundQueue> outbound_;
+  uint64_t focused_message_id_ = 0;
+  std::chrono::steady_clock::time_point last_keystroke_;
+  std::deque<uint64_t> recent_conversations_;
+  // Conversation currently on screen, and how many opens were already loaded
+  uint64_t opened_conversation_ = 0;
+  size_t opens_ = 0;
+  size_t warm_opens_ = 0;
   std::string input_text_;
   ftxui::Component input_component_;
   ftxui::Component send_button_;
   ftxui::Component messages_container_;
-  std::unordered_map<uint64_t, std::vector<discordpp::MessageHandle>>
-      user_messages_;
-  // does the user have unread messages
-  std::unordered_map<u_int64_t, bool> unread_messages_;
-  std::vector<std::function<void()>> unread_change_handlers_;
+  std::unordered_map<uint64_t, Conversation> user_messages_;
+  // Wrapped rows at the current width, by message ID
+  std::unordered_map<uint64_t, ftxui::Element> rendered_rows_;
+  int width_ = 0;
+  uint64_t names_generation_ = 0;
+  UnreadCounts unread_;
+  std::vector<std::function<void(std::span<const uint64_t>)>>
+      unread_change_handlers_;
+  // Messages received since the last tick
+  std::vector<uint64_t> incoming_;
+  // Turns a received message ID into a record. The SDK, except under test.
+  std::function<std::optional<MessageRecord>(uint64_t message_id)>
+      message_source_;
+  size_t ingested_messages_ = 0;
+  std::chrono::nanoseconds ingest_time_{0};
+  // Compression of conversations that haven't been looked at in a while
+  std::chrono::seconds compress_after_{0};
+  std::chrono::steady_clock::time_point last_compress_;
+  std::unordered_map<uint64_t, std::chrono::steady_clock::time_point>
+      last_viewed_;
+  LatencyStats decompress_latency_;
 
   void SendMessage();
-  void AddUserMessage(uint64_t message_id);
-  std::vector<discordpp::MessageHandle> GetMessages(uint64_t user_id);
-  void OnUnreadChange() const;
+  void ReceiveMessage(uint64_t message_id);
+  [[nodiscard]] std::optional<MessageRecord> LookUpMessage(
+      uint64_t message_id) const;
+  void IngestMessages();
+  void CompressIdleConversations();
+  void UpdateUserMessage(uint64_t message_id);
+  void DeleteUserMessage(uint64_t message_id);
+  /// Which conversation a message belongs to: the other user in the DM.
+  [[nodiscard]] std::optional<uint64_t> ConversationId(
+      const discordpp::MessageHandle& message) const;
+  [[nodiscard]] ftxui::Element RenderRow(const MessageRecord& message);
+  [[nodiscard]] std::vector<StyledRun> ContentRuns(
+      const MessageRecord& message) const;
+  const Conversation& GetMessages(uint64_t user_id);
+  void Load(uint64_t user_id, HistorySync::Priority priority);
+  void RecordOpen(uint64_t user_id);
+  void TouchConversation(uint64_t user_id);
+  void MergeHistory(uint64_t user_id,
+                    const std::vector<discordpp::MessageHandle>& messages,
+                    bool contiguous);
+  void OnUnreadChange(std::span<const uint64_t> user_ids) const;
+
+  friend class MessagesTestHook;
+};
+
+/// Test only: lets tools such as the stress test feed messages in without
+/// the SDK, through the same queue and ingest path as real ones. Nothing in
+/// the app uses it.
+class MessagesTestHook {
+ public:
+  /// Resolve received message IDs with `source` instead of the SDK.
+  static void SetMessageSource(
+      Messages& messages,
+      std::function<std::optional<MessageRecord>(uint64_t message_id)>
+          source) {
+    messages.message_source_ = std::move(source);
+  }
+  /// Queue a message ID, as the SDK's message created callback does.
+  static void ReceiveMessage(Messages& messages, const uint64_t message_id) {
+    messages.ReceiveMessage(message_id);
+  }
 };
 
 }  // namespace discord_social_tui
\ No newline at end of file
@@ -0,0 +1,74 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace discord_social_tui {
+
+/// Usernames and display names, with each distinct string stored once.
+///
+/// Views handed out stay valid for the life of the table, so callers can
+/// keep them rather than copying, and two interned names are equal exactly
+/// when they point at the same data. Old names are never freed, but only a
+/// rename leaves one behind, so even with a list of ten thousand friends it
+/// grows by no more than their names.
+class Names {
+ public:
+  /// The stored copy of a string, adding it if it's new.
+  std::string_view Intern(std::string_view name);
+
+  /// Record a user's current names. Returns whether either changed.
+  bool Update(uint64_t user_id, std::string_view username,
+              std::string_view display_name);
+
+  /// Empty if the user isn't known.
+  [[nodiscard]] std::string_view Username(uint64_t user_id) const;
+  /// Falls back to the username when there's no display name.
+  [[nodiscard]] std::string_view DisplayName(uint64_t user_id) const;
+
+  /// Goes up whenever a known user's names change, so anything built from
+  /// them knows to rebuild. Learning a new user's names doesn't count, so
+  /// loading a big friends list doesn't throw everything away each time.
+  [[nodiscard]] uint64_t Generation() const { return generation_; }
+  /// Number of distinct strings stored.
+  [[nodiscard]] size_t size() const { return strings_.size(); }
+
+ private:
+  struct Hash {
+    using is_transparent = void;
+    size_t operator()(const std::string_view value) const {
+      return std::hash<std::string_view>{}(value);
+    }
+  };
+
+  struct UserNames {
+    std::string_view username;
+    std::string_view display_name;
+  };
+
+  // Nodes never move, so neither do the strings in them.
+  std::unordered_set<std::string, Hash, std::equal_to<>> strings_;
+  std::unordered_map<uint64_t, UserNames> users_;
+  uint64_t generation_ = 0;
+};
+
+}  // namespace discord_social_tui
@@ -0,0 +1,111 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "discordpp.h"
+
+namespace discord_social_tui {
+
+/// Messages the user has sent that the server hasn't accepted yet.
+///
+/// Each conversation has its own queue. Up to PIPELINE_DEPTH sends are in
+/// flight at once, always issued in the order they were written. A message
+/// that fails with a transient error is retried with backoff, on its own:
+/// nothing queued behind it is sent until the server accepts it. Sends that
+/// were already in flight when it failed can't be recalled, so those may
+/// still land ahead of it. A message that gives up blocks its conversation
+/// until the user retries or discards it. While disconnected, messages wait
+/// and are flushed once the connection is back.
+class OutboundQueue {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class State {
+    /// Not sent yet, e.g. because we are offline
+    Queued,
+    Sending,
+    /// Failed, will be tried again at retry_at
+    Retrying,
+    /// Gave up, the error wasn't transient or we ran out of attempts
+    Failed,
+  };
+
+  struct PendingMessage {
+    uint64_t local_id;
+    std::string content;
+    State state = State::Queued;
+    int attempts = 0;
+    Clock::time_point retry_at{};
+    /// Has failed at least once, so it is sent alone until accepted
+    bool failed = false;
+  };
+
+  /// Called when the server has accepted a message.
+  using SentHandler =
+      std::function<void(uint64_t recipient_id, uint64_t message_id)>;
+
+  OutboundQueue(std::shared_ptr<discordpp::Client> client,
+                SentHandler on_sent);
+
+  /// Queue a message, sending it straight away if we can.
+  void Send(uint64_t recipient_id, std::string content);
+  /// Hold messages while disconnected, and flush them once connected again.
+  void SetConnected(bool connected);
+  /// Send any retries that are due. Called from the main loop.
+  void Tick();
+  /// Try messages to this recipient that gave up again, from the start.
+  void Retry(uint64_t recipient_id);
+  /// Drop messages to this recipient that gave up, letting those queued
+  /// behind them be sent.
+  void Discard(uint64_t recipient_id);
+  /// Has a message to this recipient given up?
+  [[nodiscard]] bool HasFailed(uint64_t recipient_id) const;
+
+  /// Messages to this recipient still waiting on the server, oldest first.
+  [[nodiscard]] const std::deque<PendingMessage>& GetPending(
+      uint64_t recipient_id) const;
+
+ private:
+  /// Sends in flight at once, per conversation.
+  static constexpr size_t PIPELINE_DEPTH = 4;
+  static constexpr int MAX_ATTEMPTS = 5;
+  static constexpr std::chrono::milliseconds INITIAL_BACKOFF{500};
+  static constexpr std::chrono::milliseconds MAX_BACKOFF{30000};
+
+  std::shared_ptr<discordpp::Client> client_;
+  SentHandler on_sent_;
+  bool connected_ = false;
+  uint64_t next_local_id_ = 1;
+  std::unordered_map<uint64_t, std::deque<PendingMessage>> queues_;
+
+  void Pump(uint64_t recipient_id);
+  void Issue(uint64_t recipient_id, PendingMessage& message);
+  void Complete(uint64_t recipient_id, uint64_t local_id,
+                const discordpp::ClientResult& result, uint64_t message_id);
+};
+
+/// Short description of where a pending message is up to, for display.
+[[nodiscard]] std::string DescribeState(
+    const OutboundQueue::PendingMessage& message);
+
+}  // namespace discord_social_tui
@@ -0,0 +1,29 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <filesystem>
+
+namespace discord_social_tui {
+
+/// Root directory for data that can be rebuilt from the network, such as
+/// message history. Follows XDG_CACHE_HOME, falling back to ~/.cache.
+std::filesystem::path CacheDirectory();
+
+/// Root directory for data worth keeping, such as credentials. Follows
+/// XDG_CONFIG_HOME, falling back to ~/.config.
+std::filesystem::path ConfigDirectory();
+
+}  // namespace discord_social_tui
@@ -0,0 +1,62 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "app/friend.hpp"
+#include "app/messages.hpp"
+
+namespace discord_social_tui {
+
+/// Loads conversation history in the background before it is opened, so
+/// the messages pane isn't empty the first time a conversation is shown.
+///
+/// Conversations with unread messages come first, then the friends either
+/// side of the current selection, then recently active conversations. Only
+/// a couple are fetched at a time, behind anything the user asked for, and
+/// nothing new is started while the user is typing.
+class Prefetcher {
+ public:
+  Prefetcher(std::shared_ptr<Friends> friends,
+             std::shared_ptr<Messages> messages);
+
+  /// Start prefetching more conversations, if there's room. Called from the
+  /// main loop.
+  void Tick();
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  /// How often to look for something to prefetch.
+  static constexpr std::chrono::milliseconds INTERVAL{250};
+  /// Prefetches allowed in flight at once.
+  static constexpr size_t MAX_IN_FLIGHT = 2;
+  /// How many friends either side of the selection to warm.
+  static constexpr size_t NEIGHBOURS = 2;
+
+  std::shared_ptr<Friends> friends_;
+  std::shared_ptr<Messages> messages_;
+  Clock::time_point last_tick_;
+  std::unordered_set<uint64_t> in_flight_;
+
+  [[nodiscard]] std::vector<uint64_t> Candidates() const;
+};
+
+}  // namespace discord_social_tui
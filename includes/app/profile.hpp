@@ -40,10 +40,9 @@ class Profile {
   std::shared_ptr<Friends> friends_;
 
   // Helper methods to create profile sections
-  [[nodiscard]] static ftxui::Element RenderUserInfo(
-      const discordpp::UserHandle &user_handle);
+  [[nodiscard]] static ftxui::Element RenderUserInfo(const Friend &friend_);
   [[nodiscard]] static ftxui::Element RenderStatusInfo(
-      const discordpp::UserHandle &user_handle);
+      discordpp::StatusType status);
   [[nodiscard]] static ftxui::Element RenderRelationshipInfo(
       const discordpp::UserHandle &user_handle);
   [[nodiscard]] static ftxui::Element RenderEmptyProfile();
@@ -0,0 +1,51 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace discord_social_tui {
+
+// Styles a span of message text can have, combined as bit flags.
+constexpr uint16_t STYLE_BOLD = 1U << 0U;
+constexpr uint16_t STYLE_ITALIC = 1U << 1U;
+constexpr uint16_t STYLE_UNDERLINE = 1U << 2U;
+constexpr uint16_t STYLE_STRIKETHROUGH = 1U << 3U;
+constexpr uint16_t STYLE_CODE = 1U << 4U;
+constexpr uint16_t STYLE_SPOILER = 1U << 5U;
+constexpr uint16_t STYLE_LINK = 1U << 6U;
+/// A user mention, drawn with the user's current name.
+constexpr uint16_t STYLE_MENTION = 1U << 7U;
+/// A custom emoji, drawn as its :name:.
+constexpr uint16_t STYLE_EMOJI = 1U << 8U;
+
+/// A run of message content to draw in one style. Offsets are into the
+/// content itself, so markup between spans is simply never drawn.
+struct TextSpan {
+  uint32_t offset = 0;
+  uint32_t length = 0;
+  uint16_t style = 0;
+  /// Who a mention refers to.
+  uint64_t user_id = 0;
+};
+
+/// Parse Discord markdown (bold, italics, underline, strikethrough, code
+/// and spoilers), user mentions, custom emoji and links out of message
+/// content. Returns nothing for plain text, which is drawn as it is.
+[[nodiscard]] std::vector<TextSpan> ParseRichText(std::string_view content);
+
+}  // namespace discord_social_tui
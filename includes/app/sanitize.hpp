@@ -0,0 +1,36 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+
+#include "app/message_record.hpp"
+
+namespace discord_social_tui {
+
+/// Make text safe to draw in the terminal. Escape sequences (and their C1
+/// equivalents) are stripped, other control characters are dropped, tabs
+/// become spaces and invalid UTF-8 is replaced with U+FFFD. Newlines are
+/// kept. Returns whether anything changed.
+///
+/// Clean text is checked 16 or 32 bytes at a time with SSE2 or AVX2 where
+/// the build targets them, so the common case costs next to nothing.
+bool SanitizeText(std::string& text);
+
+/// Sanitize a message's content and author name, unless it already has
+/// been. Done once as messages come in, so rendering never rescans them.
+void Sanitize(MessageRecord& record);
+
+}  // namespace discord_social_tui
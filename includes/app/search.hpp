@@ -0,0 +1,67 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "app/friend.hpp"
+#include "app/message_cache.hpp"
+#include "app/search_index.hpp"
+#include "ftxui/component/component.hpp"
+
+namespace discord_social_tui {
+
+/// Search across the message history of every conversation.
+class Search {
+ public:
+  Search(std::shared_ptr<SearchIndex> index,
+         std::shared_ptr<MessageCache> cache, std::shared_ptr<Friends> friends);
+
+  /// Render the search input and results
+  [[nodiscard]] ftxui::Component Render();
+
+  /// Add a callback for when a search result is chosen
+  void AddResultSelectedHandler(
+      std::function<void(uint64_t conversation_id, uint64_t message_id)>
+          handler);
+
+ private:
+  /// Most results to show for a query
+  static constexpr size_t MAX_RESULTS = 50;
+  /// How much of each matching message to show
+  static constexpr size_t SNIPPET_LENGTH = 80;
+
+  std::shared_ptr<SearchIndex> index_;
+  std::shared_ptr<MessageCache> cache_;
+  std::shared_ptr<Friends> friends_;
+  std::string query_;
+  std::string status_;
+  std::vector<SearchHit> hits_;
+  int selected_ = 0;
+  ftxui::Component input_component_;
+  ftxui::Component results_;
+  std::vector<std::function<void(uint64_t, uint64_t)>>
+      result_selected_handlers_;
+
+  void RunQuery();
+  [[nodiscard]] std::string ResultLabel(const SearchHit& hit);
+  void OnResultSelected() const;
+};
+
+}  // namespace discord_social_tui
@@ -0,0 +1,89 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "app/message_record.hpp"
+
+namespace discord_social_tui {
+
+/// A single search result.
+struct SearchHit {
+  uint64_t message_id = 0;
+  uint64_t conversation_id = 0;
+  double score = 0;
+};
+
+/// Inverted index over message content for full-text search.
+///
+/// Content is split into case-folded tokens, and each token maps to a
+/// posting list of the message IDs containing it, kept sorted so queries can
+/// intersect lists without ever looking at message content. The index is
+/// updated as messages arrive and saved to disk with delta and varint
+/// encoded postings.
+class SearchIndex {
+ public:
+  /// Load a previously saved index, remembering the path for Save().
+  /// A missing or unreadable file leaves the index empty.
+  void Open(const std::filesystem::path& path);
+  /// Write the index to disk, if it has changed since it was loaded.
+  void Save();
+
+  /// Index a message. Messages that are already indexed are ignored.
+  void Add(const MessageRecord& record);
+  /// Remove a message, e.g. because it was deleted or is about to be
+  /// re-added after an edit. The record must be the one that was indexed.
+  void Remove(const MessageRecord& record);
+  [[nodiscard]] bool Contains(uint64_t message_id) const;
+  [[nodiscard]] size_t size() const { return documents_.size(); }
+
+  /// Messages containing every term in the query, best matches first.
+  [[nodiscard]] std::vector<SearchHit> Search(std::string_view query,
+                                              size_t limit) const;
+
+  /// Split text into lower-cased search terms.
+  [[nodiscard]] static std::vector<std::string> Tokenize(std::string_view text);
+
+ private:
+  struct Posting {
+    uint64_t message_id = 0;
+    uint32_t frequency = 0;
+    // Copy of the document length, so ranking never leaves the posting list
+    uint32_t length = 0;
+  };
+
+  struct Document {
+    uint64_t conversation_id = 0;
+    uint32_t length = 0;
+  };
+
+  std::filesystem::path path_;
+  std::unordered_map<std::string, std::vector<Posting>> postings_;
+  std::unordered_map<uint64_t, Document> documents_;
+  // Sum of all document lengths, for length normalisation when ranking
+  uint64_t total_length_ = 0;
+  bool dirty_ = false;
+
+  bool Load(const std::filesystem::path& path);
+};
+
+}  // namespace discord_social_tui
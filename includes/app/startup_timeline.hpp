@@ -0,0 +1,95 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace discord_social_tui {
+
+/// When each part of startup ran, measured from when the process started,
+/// so the critical path to the first frame and to being usable can be seen.
+/// Phases can be recorded from any thread.
+class StartupTimeline {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /// Points in startup that are reported as metrics.
+  enum class Milestone {
+    // The UI has been drawn for the first time
+    FirstFrame,
+    // Authorized and connected
+    Ready,
+    // Drawn with live data after becoming ready
+    Interactive,
+  };
+
+  /// Ends a phase when it goes out of scope.
+  class Scope {
+   public:
+    Scope(StartupTimeline& timeline, std::string name);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    Scope(Scope&&) = delete;
+    Scope& operator=(Scope&&) = delete;
+
+   private:
+    StartupTimeline& timeline_;
+    std::string name_;
+  };
+
+  explicit StartupTimeline(Clock::time_point started = Clock::now());
+
+  /// Start timing a phase. Starting it again has no effect.
+  void Begin(std::string_view name);
+  /// Finish timing a phase that has begun.
+  void End(std::string_view name);
+  /// Time a phase until the returned scope is destroyed.
+  [[nodiscard]] Scope Measure(std::string name);
+
+  /// Record a milestone. Only the first time counts.
+  void Mark(Milestone milestone);
+  /// How long after starting the milestone was reached, if it has been.
+  [[nodiscard]] std::optional<Clock::duration> Elapsed(
+      Milestone milestone) const;
+
+  /// One line summary of the milestones, for the log.
+  [[nodiscard]] std::string Summary() const;
+  /// Every phase in the order it began, followed by the milestones.
+  [[nodiscard]] std::string Report() const;
+
+ private:
+  static constexpr size_t MILESTONE_COUNT = 3;
+
+  struct Phase {
+    std::string name;
+    Clock::duration begin{};
+    std::optional<Clock::duration> end;
+  };
+
+  Clock::time_point started_;
+  mutable std::mutex mutex_;
+  std::vector<Phase> phases_;
+  std::array<std::optional<Clock::duration>, MILESTONE_COUNT> milestones_;
+};
+
+}  // namespace discord_social_tui
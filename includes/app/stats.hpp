@@ -0,0 +1,52 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace discord_social_tui {
+
+/// Collects latency samples and summarises them for logs and the UI.
+/// Only the most recent samples are kept, so it is safe to record into for
+/// the lifetime of the app.
+class LatencyStats {
+ public:
+  void Record(std::chrono::nanoseconds sample);
+
+  /// Total number of samples ever recorded.
+  [[nodiscard]] size_t Count() const { return count_; }
+  /// Percentile (0-100) over the retained samples.
+  [[nodiscard]] std::chrono::nanoseconds Percentile(double percentile) const;
+  [[nodiscard]] std::chrono::nanoseconds Max() const;
+
+  /// Human readable summary, e.g. "n=12 p50=3.1ms p99=9.8ms max=12.0ms"
+  [[nodiscard]] std::string Summary() const;
+
+ private:
+  static constexpr size_t MAX_SAMPLES = 4096;
+
+  std::vector<std::chrono::nanoseconds> samples_;
+  size_t next_ = 0;
+  size_t count_ = 0;
+};
+
+/// Format a duration with a unit that suits its size, e.g. "850us" or
+/// "1.2s".
+std::string FormatDuration(std::chrono::nanoseconds duration);
+
+}  // namespace discord_social_tui
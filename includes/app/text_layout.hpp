@@ -0,0 +1,49 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace discord_social_tui {
+
+/// A piece of text and the style to draw it with. The style is carried
+/// along by wrapping, but otherwise up to the caller.
+struct StyledRun {
+  std::string text;
+  uint32_t style = 0;
+};
+
+/// One wrapped line, with neighbouring runs of the same style joined up.
+using StyledLine = std::vector<StyledRun>;
+
+/// Word-wrap text into lines that fit within a number of terminal columns.
+///
+/// The first line can be given less room than the rest, to leave space for
+/// something in front of it, such as the author's name. Words too long for
+/// a line are broken between characters, never within one, and newlines in
+/// the text always start a new line.
+[[nodiscard]] std::vector<std::string> WrapText(std::string_view text,
+                                                int first_width, int width);
+
+/// WrapText(), for text made up of differently styled runs. Words can span
+/// runs, and are never broken where the style changes.
+[[nodiscard]] std::vector<StyledLine> WrapRuns(std::span<const StyledRun> runs,
+                                               int first_width, int width);
+
+}  // namespace discord_social_tui
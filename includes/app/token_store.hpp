@@ -0,0 +1,58 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include "discordpp.h"
+
+namespace discord_social_tui {
+
+/// The tokens from an OAuth2 token exchange.
+struct StoredToken {
+  std::string access_token;
+  std::string refresh_token;
+  discordpp::AuthorizationTokenType token_type =
+      discordpp::AuthorizationTokenType::Bearer;
+  std::chrono::system_clock::time_point expires_at;
+
+  /// Has the access token expired, or will it within `margin`?
+  [[nodiscard]] bool ExpiresWithin(std::chrono::seconds margin) const;
+};
+
+/// Keeps the tokens between runs, so startup doesn't need the browser.
+/// The file is readable by the owner only (0600), in a directory only they
+/// can enter, and replaced atomically so it is never half written.
+class TokenStore {
+ public:
+  explicit TokenStore(std::filesystem::path path);
+
+  /// The stored tokens, if there are any and they can be read.
+  [[nodiscard]] std::optional<StoredToken> Load() const;
+  /// Store tokens, replacing any already stored.
+  bool Save(const StoredToken& token) const;
+  /// Forget the stored tokens, once they have been rejected. Not for
+  /// transient failures, which the same tokens may well get past.
+  void Clear() const;
+
+ private:
+  std::filesystem::path path_;
+};
+
+}  // namespace discord_social_tui
@@ -0,0 +1,81 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace discord_social_tui {
+
+/// Unread message counts and last-read markers for every conversation.
+///
+/// Stored in a single flat open-addressed table, so looking up a count is
+/// one probe into contiguous memory, and a running total means the overall
+/// count never needs a scan. Every change reports whether anything actually
+/// changed, so callers only notify when it has.
+class UnreadCounts {
+ public:
+  UnreadCounts();
+
+  /// Count a newly received message. Messages at or before the last-read
+  /// marker, or no newer than the newest one counted, aren't counted, so
+  /// replays are never counted twice. Returns whether the count changed.
+  bool Add(uint64_t conversation_id, uint64_t message_id);
+  /// Uncount a deleted message. Individual messages aren't tracked, so
+  /// this assumes any message after the last-read marker was counted; one
+  /// that arrived out of order and was skipped still takes one off.
+  /// Returns whether the count changed.
+  bool Remove(uint64_t conversation_id, uint64_t message_id);
+  /// Mark everything received in a conversation as read. Returns whether
+  /// the count changed.
+  bool MarkRead(uint64_t conversation_id);
+  /// Carry a count over from a previous run, for a conversation with
+  /// nothing counted yet. Returns whether the count changed.
+  bool Restore(uint64_t conversation_id, uint32_t count);
+
+  /// Unread messages in a conversation.
+  [[nodiscard]] uint32_t Count(uint64_t conversation_id) const;
+  /// The newest message ID the user has read in a conversation, or 0.
+  [[nodiscard]] uint64_t LastRead(uint64_t conversation_id) const;
+  /// Unread messages across every conversation.
+  [[nodiscard]] uint64_t Total() const { return total_; }
+  /// Conversations with unread messages.
+  [[nodiscard]] std::vector<uint64_t> Conversations() const;
+
+ private:
+  struct Entry {
+    // 0 marks an empty slot; user IDs are never 0.
+    uint64_t conversation_id = 0;
+    uint64_t last_read = 0;
+    uint64_t newest = 0;
+    uint32_t count = 0;
+  };
+
+  static constexpr size_t INITIAL_CAPACITY = 64;
+
+  // Capacity is always a power of two, and kept at most half full.
+  std::vector<Entry> entries_;
+  size_t used_ = 0;
+  uint64_t total_ = 0;
+
+  [[nodiscard]] const Entry* Find(uint64_t conversation_id) const;
+  Entry& FindOrInsert(uint64_t conversation_id);
+  /// The slot holding this conversation, or the empty slot it would go in.
+  [[nodiscard]] size_t Probe(uint64_t conversation_id) const;
+  void Grow();
+};
+
+}  // namespace discord_social_tui
@@ -16,47 +16,124 @@
 
 #include <spdlog/spdlog.h>
 
+#include <fstream>
 #include <iostream>
 #include <optional>
+#include <span>
 #include <utility>
 
 #include "app/friend.hpp"
+#include "app/paths.hpp"
 #include "app/profile.hpp"
+#include "app/stats.hpp"
 #include "ftxui/component/loop.hpp"
 #include "ftxui/dom/elements.hpp"
 
 namespace discord_social_tui {
 
+namespace {
+
+// Open a user's message history, and catch the search index up with
+// anything cached since it was last saved.
+void OpenHistory(const std::filesystem::path& directory, MessageCache& cache,
+                 SearchIndex& index) {
+  if (!cache.Open(directory / "messages")) {
+    SPDLOG_WARN("Message cache unavailable, history will only be fetched");
+  }
+
+  index.Open(directory / "search.idx");
+  cache.ForEach(
+      [&index](const uint64_t message_id) {
+        return !index.Contains(message_id);
+      },
+      [&index](const MessageRecord& record) { index.Add(record); });
+}
+
+}  // namespace
+
 // Constructor for the App class
 App::App(const uint64_t application_id,
-         const std::shared_ptr<discordpp::Client>& client)
+         const std::shared_ptr<discordpp::Client>& client,
+         const std::chrono::seconds compress_after,
+         std::shared_ptr<StartupTimeline> timeline)
     : application_id_{application_id},
       client_{client},
+      timeline_{std::move(timeline)},
       presence_{std::make_shared<Presence>(client)},
       voice_{std::make_shared<Voice>(client, presence_)},
-      messages_{std::make_shared<Messages>(client)},
-      friends_{std::make_shared<Friends>(client, messages_, voice_)},
+      message_cache_{std::make_shared<MessageCache>()},
+      search_index_{std::make_shared<SearchIndex>()},
+      names_{std::make_shared<Names>()},
+      messages_{std::make_shared<Messages>(client, message_cache_,
+                                           search_index_, names_)},
+      friends_{std::make_shared<Friends>(client, messages_, voice_, names_)},
       left_width_{LEFT_WIDTH},
       screen_{ftxui::ScreenInteractive::Fullscreen()},
       show_authenticating_modal_{false},
       profile_{std::make_unique<Profile>(friends_)},
-      buttons_{std::make_shared<Buttons>(friends_, voice_)} {
+      prefetcher_{std::make_unique<Prefetcher>(friends_, messages_)},
+      search_{std::make_unique<Search>(search_index_, message_cache_,
+                                       friends_)},
+      buttons_{std::make_shared<Buttons>(friends_, voice_)},
+      connection_{std::make_unique<ConnectionManager>(
+          client, application_id,
+          std::make_shared<TokenStore>(ConfigDirectory() /
+                                       std::to_string(application_id) /
+                                       "token"))} {
   // Log the application ID
   SPDLOG_INFO("App initialized with Discord Application ID: {}",
               application_id_);
 
+  // Connecting is mostly waiting on the network or the browser, so get it
+  // going first. Nothing is delivered until the loop runs callbacks, by
+  // which time everything below is in place.
+  connection_->AddStatusChangeHandler(
+      [this](const ConnectionManager::Status status) {
+        messages_->SetConnected(status == ConnectionManager::Status::Ready);
+      });
+  connection_->AddReadyHandler([this](const bool first) {
+    if (first) {
+      timeline_->End("connect");
+      timeline_->Mark(StartupTimeline::Milestone::Ready);
+      const auto phase = timeline_->Measure("ready");
+      Ready();
+    } else {
+      Reconnected();
+    }
+  });
+  timeline_->Begin("connect");
+  connection_->Start();
+  PrepareHistory();
+
+  const auto phase = timeline_->Measure("components");
   // Set Friends reference in Voice and Messages to break circular dependency
   voice_->SetFriends(friends_);
   messages_->SetFriends(friends_);
+  messages_->SetCompressAfter(compress_after);
 
   auto profile_component = profile_->Render();
   auto messages_component = messages_->Render() | ftxui::flex;
+  auto search_component = search_->Render() | ftxui::flex;
   // Content container with button row and content area
   const auto content = ftxui::Container::Vertical({
       buttons_->GetComponent(),
       profile_component,
   });
 
+  // Swap the content area over to one of the views
+  const auto show = [content, profile_component, messages_component,
+                     search_component](const ftxui::Component& view) {
+    for (const auto& component :
+         {profile_component, messages_component, search_component}) {
+      if (component != view) {
+        component->Detach();
+      }
+    }
+    if (view->Parent() == nullptr) {
+      content->Add(view);
+    }
+  };
+
   // Add selection change handler
   friends_->AddSelectionChangeHandler([this, messages_component]() {
     buttons_->VoiceChanged();
@@ -65,22 +142,31 @@ App::App(const uint64_t application_id,
     }
   });
 
-  buttons_->AddProfileClickHandler(
-      [profile_component, messages_component, content]() {
-        messages_component->Detach();
-        if (profile_component->Parent() == nullptr) {
-          content->Add(profile_component);
-        }
+  // Keep the unread badge on the DM button up to date
+  messages_->AddUnreadChangeHandler(
+      [this](std::span<const uint64_t> /*user_ids*/) {
+        buttons_->SetUnreadTotal(messages_->UnreadTotal());
       });
 
-  buttons_->AddDMClickHandler(
-      [this, profile_component, messages_component, content]() {
-        profile_component->Detach();
-        messages_->ResetSelectedUnreadMessages();
+  buttons_->AddProfileClickHandler(
+      [show, profile_component]() { show(profile_component); });
+
+  buttons_->AddDMClickHandler([this, show, messages_component]() {
+    messages_->ResetSelectedUnreadMessages();
+    show(messages_component);
+  });
 
-        if (messages_component->Parent() == nullptr) {
-          content->Add(messages_component);
-        }
+  buttons_->AddSearchClickHandler(
+      [show, search_component]() { show(search_component); });
+
+  // Jump to a search result in its conversation
+  search_->AddResultSelectedHandler(
+      [this, show, messages_component](const uint64_t conversation_id,
+                                       const uint64_t message_id) {
+        friends_->SetSelectedIndexByFriendId(conversation_id);
+        messages_->FocusMessage(message_id);
+        messages_->ResetSelectedUnreadMessages();
+        show(messages_component);
       });
 
   buttons_->AddVoiceClickHandler([this]() { voice_->Call(); });
@@ -111,94 +197,96 @@ ftxui::Component App::AuthenticatingModal(const ftxui::Component& main) const {
   return ftxui::Modal(main, loading_content, &show_authenticating_modal_);
 }
 
-void App::StartStatusChangedCallback() {
-  client_->SetStatusChangedCallback([&](const discordpp::Client::Status status,
-                                        const discordpp::Client::Error error,
-                                        int32_t errorDetail) {
-    SPDLOG_INFO("Social SDK Status Change: {}",
-                discordpp::Client::StatusToString(status));
-
-    if (error != discordpp::Client::Error::None) {
-      SPDLOG_ERROR("Social SDK Status Error: {}, Details: {}",
-                   discordpp::Client::ErrorToString(error), errorDetail);
-    }
-
-    if (status == discordpp::Client::Status::Ready) {
-      // Use call_once to ensure Ready() is only called once
-      std::call_once(ready_flag_, [this]() { Ready(); });
-    }
-  });
-}
-
 // Function to set up the application once we're authenticated.
 void App::Ready() {
-  // Hide the modal
-  show_authenticating_modal_ = false;
+  // Cached history is per user, so it can only be opened once we are ready
+  OpenMessageCache();
+  messages_->HistoryOpened();
+  messages_->SyncHistory();
+  // Our own messages are rendered with our name too
+  if (const auto current_user = client_->GetCurrentUserV2()) {
+    names_->Update(current_user->Id(), current_user->Username(),
+                   current_user->DisplayName());
+  }
   // Set up rich presence
   presence_->SetDefaultPresence();
   // initial load of friends
   friends_->Refresh();
 }
 
-void App::Authorize() {
-  // Show the authenticating modal while we're authorizing
-  show_authenticating_modal_ = true;
-
-  // Generate OAuth2 code verifier for authentication
-  auto code_verifier = client_->CreateAuthorizationCodeVerifier();
-
-  // Set up authentication arguments
-  discordpp::AuthorizationArgs args{};
-  args.SetClientId(application_id_);
-  args.SetScopes(discordpp::Client::GetDefaultCommunicationScopes());
-  args.SetCodeChallenge(code_verifier.Challenge());
-
-  // Begin authentication process
-  client_->Authorize(args, [this, code_verifier](
-                               const discordpp::ClientResult& result,
-                               const std::string& code,
-                               const std::string& redirect_uri) {
-    if (!result.Successful()) {
-      SPDLOG_ERROR("Authorization failed: {}", result.Error());
-      show_authenticating_modal_ = false;
-      return;
-    }
+// Back after an outage. Everything cached stayed on screen throughout, so
+// only what changed while we were away needs fetching.
+void App::Reconnected() {
+  messages_->SyncHistory();
+  // Presence doesn't survive the connection, and friends may have come and
+  // gone. Only those who changed are touched.
+  presence_->SetDefaultPresence();
+  friends_->Refresh();
+}
 
-    SPDLOG_INFO("Authorization successful, exchanging code for token");
-
-    // Exchange auth code for access token
-    client_->GetToken(
-        application_id_, code, code_verifier.Verifier(), redirect_uri,
-        [this](
-            const discordpp::ClientResult& result,
-            const std::string&  // NOLINT(bugprone-easily-swappable-parameters)
-                access_token,
-            const std::string&  // NOLINT(bugprone-easily-swappable-parameters)
-                refresh_token,
-            const discordpp::AuthorizationTokenType token_type,
-            int32_t expires_in, const std::string& scope) {
-          if (!result.Successful()) {
-            SPDLOG_ERROR("Token exchange failed: {}", result.Error());
-            return;
-          }
-
-          SPDLOG_INFO(
-              "Token exchange successful, access token expires in {} seconds",
-              expires_in);
-
-          // Set the authentication token for the client
-          client_->UpdateToken(token_type, std::string(access_token),
-                               [this](const discordpp::ClientResult& result) {
-                                 if (!result.Successful()) {
-                                   SPDLOG_ERROR("Token update failed: {}",
-                                                result.Error());
-                                 } else {
-                                   SPDLOG_INFO("Connection Social SDK...");
-                                   this->client_->Connect();
-                                 }
-                               });
-        });
-  });
+std::filesystem::path App::FriendsSnapshotPath(const uint64_t user_id) const {
+  return HistoryDirectory(user_id) / "friends.snap";
+}
+
+std::filesystem::path App::HistoryDirectory(const uint64_t user_id) const {
+  return CacheDirectory() / std::to_string(application_id_) /
+         std::to_string(user_id);
+}
+
+std::filesystem::path App::LastUserPath() const {
+  return CacheDirectory() / std::to_string(application_id_) / "last_user";
+}
+
+std::optional<uint64_t> App::LastUserId() const {
+  std::ifstream file(LastUserPath());
+  uint64_t user_id = 0;
+  if (!(file >> user_id)) {
+    return std::nullopt;
+  }
+  return user_id;
+}
+
+// Whoever was logged in last time almost certainly is again, so their
+// history can be opened on another thread while we connect. It is handed
+// over once we know for sure.
+void App::PrepareHistory() {
+  const auto user_id = LastUserId();
+  if (!user_id) {
+    return;
+  }
+  prepared_history_ = std::async(
+      std::launch::async, [user_id = *user_id,
+                           directory = HistoryDirectory(*user_id),
+                           timeline = timeline_]() {
+        const auto phase = timeline->Measure("history");
+        auto history = std::make_unique<PreparedHistory>();
+        history->user_id = user_id;
+        OpenHistory(directory, history->cache, history->index);
+        return history;
+      });
+}
+
+void App::OpenMessageCache() {
+  const auto current_user = client_->GetCurrentUserV2();
+  if (!current_user) {
+    SPDLOG_ERROR("Current user not available, message cache disabled");
+    return;
+  }
+
+  const auto user_id = current_user->Id();
+  std::unique_ptr<PreparedHistory> prepared;
+  if (prepared_history_.valid()) {
+    prepared = prepared_history_.get();
+  }
+  if (prepared && prepared->user_id == user_id) {
+    *message_cache_ = std::move(prepared->cache);
+    *search_index_ = std::move(prepared->index);
+  } else {
+    OpenHistory(HistoryDirectory(user_id), *message_cache_, *search_index_);
+  }
+
+  // Remember who this was, for opening their history early next time.
+  std::ofstream(LastUserPath()) << user_id << '\n';
 }
 
 // Run the application
@@ -206,10 +294,14 @@ int App::Run() {
   constexpr uint SLEEP_MILLISECONDS = 10;
   const std::string EVENT = "Render Me!";
   constexpr uint RENDER_LIMIT = 1000 / SLEEP_MILLISECONDS;
-  StartStatusChangedCallback();
 
-  // Start the authorization process
-  Authorize();
+  // Show who we knew about last time while we connect, assuming it's the
+  // same user again.
+  timeline_->Begin("snapshot");
+  if (const auto user_id = LastUserId()) {
+    friends_->LoadSnapshot(FriendsSnapshotPath(*user_id));
+  }
+  timeline_->End("snapshot");
 
   friends_->Run();
   // Start the voice process
@@ -219,10 +311,35 @@ int App::Run() {
 
   // Run the application loop
   uint render_counter = 0;
+  // Time spent working each frame, sleep excluded. Logging happens on this
+  // thread too, so this is where its cost shows up.
+  LatencyStats frame_times;
+  timeline_->Begin("terminal");
   ftxui::Loop loop(&screen_, container_);
+  timeline_->End("terminal");
+  bool interactive = false;
   while (!loop.HasQuitted()) {
+    const auto frame_started = std::chrono::steady_clock::now();
     loop.RunOnce();
+    // Startup is over once a frame has been drawn with live data.
+    if (!interactive) {
+      timeline_->Mark(StartupTimeline::Milestone::FirstFrame);
+      if (timeline_->Elapsed(StartupTimeline::Milestone::Ready)) {
+        timeline_->Mark(StartupTimeline::Milestone::Interactive);
+        interactive = true;
+      }
+    }
     discordpp::RunCallbacks();
+    connection_->Tick();
+    // With the last run's friends to show, only block on the browser.
+    show_authenticating_modal_ =
+        connection_->IsWaitingForBrowser() ||
+        (connection_->IsAuthorizing() && !friends_->IsStale());
+    // Wrapped messages are laid out again only when the terminal is resized
+    // or the divider moves. One column goes to the divider itself.
+    messages_->SetWidth(screen_.dimx() - left_width_ - 1);
+    messages_->Tick();
+    prefetcher_->Tick();
 
     // refresh screen every second, since friends and such change all the time.
     render_counter++;
@@ -230,9 +347,20 @@ int App::Run() {
       screen_.PostEvent(ftxui::Event::Special(EVENT));
     }
 
+    frame_times.Record(std::chrono::steady_clock::now() - frame_started);
     std::this_thread::sleep_for(std::chrono::milliseconds(SLEEP_MILLISECONDS));
   }
 
+  search_index_->Save();
+  if (const auto current_user = client_->GetCurrentUserV2()) {
+    friends_->SaveSnapshot(FriendsSnapshotPath(current_user->Id()));
+  }
+  messages_->LogStats();
+  SPDLOG_INFO("Frame time: {}", frame_times.Summary());
+  SPDLOG_INFO("Startup: {}", timeline_->Summary());
+  if (connection_->OutageLatency().Count() > 0) {
+    SPDLOG_INFO("Outage to usable: {}", connection_->OutageLatency().Summary());
+  }
   return EXIT_SUCCESS;
 }
 
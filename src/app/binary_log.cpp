@@ -0,0 +1,465 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/binary_log.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "app/compression.hpp"
+#include "app/json_escape.hpp"
+
+namespace discord_social_tui {
+
+namespace {
+
+constexpr std::string_view SEGMENT_MAGIC{"DSTLOG1\n"};
+constexpr std::string_view COMPRESSED_MAGIC{"DSTLOGZ\n"};
+constexpr std::string_view SEGMENT_EXTENSION = ".bin";
+constexpr std::string_view COMPRESSED_EXTENSION = ".lz";
+
+// Each record starts with its type. Loggers and call sites are written the
+// first time an entry in the segment refers to them.
+enum class RecordType : uint8_t { Logger = 1, CallSite = 2, Entry = 3 };
+
+void PutVarint(spdlog::memory_buf_t& buffer, uint64_t value) {
+  while (value >= 0x80U) {
+    buffer.push_back(static_cast<char>((value & 0x7FU) | 0x80U));
+    value >>= 7U;
+  }
+  buffer.push_back(static_cast<char>(value));
+}
+
+void PutString(spdlog::memory_buf_t& buffer, const std::string_view value) {
+  PutVarint(buffer, value.size());
+  buffer.append(value.data(), value.data() + value.size());
+}
+
+// Times are stored as the difference from the entry before, which can go
+// backwards when several threads log at once.
+uint64_t ZigZag(const int64_t value) {
+  return (static_cast<uint64_t>(value) << 1U) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(const uint64_t value) {
+  return static_cast<int64_t>(value >> 1U) ^ -static_cast<int64_t>(value & 1U);
+}
+
+bool GetVarint(const std::string_view buffer, size_t& position,
+               uint64_t& value) {
+  value = 0;
+  for (uint32_t shift = 0; shift < 64 && position < buffer.size();
+       shift += 7) {
+    const auto byte = static_cast<uint64_t>(
+        static_cast<unsigned char>(buffer[position++]));
+    value |= (byte & 0x7FU) << shift;
+    if ((byte & 0x80U) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool GetString(const std::string_view buffer, size_t& position,
+               std::string_view& value) {
+  uint64_t length = 0;
+  if (!GetVarint(buffer, position, length) ||
+      buffer.size() - position < length) {
+    return false;
+  }
+  value = buffer.substr(position, length);
+  position += length;
+  return true;
+}
+
+std::optional<std::string> ReadFile(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return std::nullopt;
+  }
+  return std::string{std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>()};
+}
+
+// The segment number of a file belonging to the log at `base`, if it is
+// one of its segments.
+std::optional<uint64_t> SegmentIndex(const std::filesystem::path& base,
+                                     const std::filesystem::path& file) {
+  const auto prefix = base.filename().string() + ".";
+  const auto name = file.filename().string();
+  auto rest = std::string_view(name);
+  if (!rest.starts_with(prefix)) {
+    return std::nullopt;
+  }
+  rest.remove_prefix(prefix.size());
+  if (rest.ends_with(COMPRESSED_EXTENSION)) {
+    rest.remove_suffix(COMPRESSED_EXTENSION.size());
+  }
+  if (!rest.ends_with(SEGMENT_EXTENSION)) {
+    return std::nullopt;
+  }
+  rest.remove_suffix(SEGMENT_EXTENSION.size());
+
+  uint64_t index = 0;
+  const auto [ptr, error] =
+      std::from_chars(rest.data(), rest.data() + rest.size(), index);
+  if (error != std::errc{} || ptr != rest.data() + rest.size()) {
+    return std::nullopt;
+  }
+  return index;
+}
+
+std::filesystem::path Directory(const std::filesystem::path& base) {
+  return base.has_parent_path() ? base.parent_path()
+                                : std::filesystem::path(".");
+}
+
+// Replace a finished segment with a compressed copy. Nothing is logged from
+// here, as this runs underneath the logger; a segment that can't be
+// compressed is left as it is, and decodes just the same.
+void CompressSegment(const std::filesystem::path& path) {
+  const auto data = ReadFile(path);
+  if (!data) {
+    return;
+  }
+  const auto block = Compress(std::as_bytes(std::span(*data)));
+
+  spdlog::memory_buf_t header;
+  header.append(COMPRESSED_MAGIC.data(),
+                COMPRESSED_MAGIC.data() + COMPRESSED_MAGIC.size());
+  PutVarint(header, data->size());
+
+  // Write to the side and rename, so a crash never leaves a half-written
+  // segment behind.
+  auto compressed = path;
+  compressed += COMPRESSED_EXTENSION;
+  auto temporary = compressed;
+  temporary += ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(header.data(), static_cast<std::streamsize>(header.size()));
+    file.write(reinterpret_cast<const char*>(block.data()),
+               static_cast<std::streamsize>(block.size()));
+    if (!file) {
+      std::error_code error;
+      std::filesystem::remove(temporary, error);
+      return;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temporary, compressed, error);
+  if (!error) {
+    std::filesystem::remove(path, error);
+  }
+}
+
+// Local time as the text log shows it, e.g. "2025-06-01 12:34:56.789"
+std::string FormatTime(const int64_t nanoseconds) {
+  constexpr int64_t NANOSECONDS_PER_SECOND = 1'000'000'000;
+  constexpr int64_t NANOSECONDS_PER_MILLISECOND = 1'000'000;
+  const std::time_t seconds = nanoseconds / NANOSECONDS_PER_SECOND;
+  const auto milliseconds =
+      (nanoseconds % NANOSECONDS_PER_SECOND) / NANOSECONDS_PER_MILLISECOND;
+
+  std::tm local{};
+  localtime_r(&seconds, &local);
+  std::array<char, 32> buffer{};
+  const auto length = std::strftime(buffer.data(), buffer.size(),
+                                    "%Y-%m-%d %H:%M:%S", &local);
+  return std::string(buffer.data(), length) +
+         spdlog::fmt_lib::format(".{:03}", milliseconds);
+}
+
+}  // namespace
+
+BinaryLogSink::BinaryLogSink(std::filesystem::path base,
+                             const size_t max_segment_size,
+                             const size_t max_segments)
+    : base_(std::move(base)),
+      max_segment_size_(max_segment_size),
+      max_segments_(std::max<size_t>(max_segments, 1)) {
+  // Carry on numbering from where the last run got to, and compress
+  // whatever it didn't get to.
+  std::error_code error;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(Directory(base_), error)) {
+    const auto index = SegmentIndex(base_, entry.path());
+    if (!index) {
+      continue;
+    }
+    segment_ = std::max(segment_, *index);
+    if (entry.path().extension() == SEGMENT_EXTENSION) {
+      to_compress_.push_back(entry.path());
+    }
+  }
+  ++segment_;
+
+  OpenSegment();
+  RemoveOldSegments();
+  compressor_ = std::thread([this] { CompressLoop(); });
+}
+
+BinaryLogSink::~BinaryLogSink() {
+  {
+    const std::scoped_lock lock(compress_mutex_);
+    stopping_ = true;
+  }
+  compress_ready_.notify_one();
+  compressor_.join();
+}
+
+void BinaryLogSink::sink_it_(const spdlog::details::log_msg& msg) {
+  buffer_.clear();
+
+  const std::string_view logger_name(msg.logger_name.data(),
+                                     msg.logger_name.size());
+  auto logger = loggers_.find(logger_name);
+  if (logger == loggers_.end()) {
+    logger =
+        loggers_.emplace(std::string(logger_name), loggers_.size() + 1).first;
+    buffer_.push_back(static_cast<char>(RecordType::Logger));
+    PutVarint(buffer_, logger->second);
+    PutString(buffer_, logger->first);
+  }
+
+  // Zero for messages logged without a call site, such as the SDK's.
+  uint64_t call_site_id = 0;
+  if (!msg.source.empty()) {
+    const auto [call_site, added] = call_sites_.try_emplace(
+        {msg.source.filename, msg.source.line}, call_sites_.size() + 1);
+    call_site_id = call_site->second;
+    if (added) {
+      buffer_.push_back(static_cast<char>(RecordType::CallSite));
+      PutVarint(buffer_, call_site_id);
+      PutString(buffer_, msg.source.filename);
+      PutVarint(buffer_, msg.source.line);
+      PutString(buffer_, msg.source.funcname != nullptr ? msg.source.funcname
+                                                        : "");
+    }
+  }
+
+  const int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           msg.time.time_since_epoch())
+                           .count();
+  buffer_.push_back(static_cast<char>(RecordType::Entry));
+  PutVarint(buffer_, ZigZag(time - previous_time_));
+  buffer_.push_back(static_cast<char>(msg.level));
+  PutVarint(buffer_, logger->second);
+  PutVarint(buffer_, call_site_id);
+  PutVarint(buffer_, msg.thread_id);
+  PutString(buffer_, std::string_view(msg.payload.data(), msg.payload.size()));
+  previous_time_ = time;
+
+  file_.write(buffer_);
+  segment_size_ += buffer_.size();
+  if (segment_size_ >= max_segment_size_) {
+    Rotate();
+  }
+}
+
+void BinaryLogSink::flush_() { file_.flush(); }
+
+std::filesystem::path BinaryLogSink::SegmentPath(const uint64_t segment) const {
+  auto path = base_;
+  path += spdlog::fmt_lib::format(".{:06}", segment);
+  path += SEGMENT_EXTENSION;
+  return path;
+}
+
+void BinaryLogSink::OpenSegment() {
+  file_.open(SegmentPath(segment_).string(), true);
+  buffer_.clear();
+  buffer_.append(SEGMENT_MAGIC.data(),
+                 SEGMENT_MAGIC.data() + SEGMENT_MAGIC.size());
+  file_.write(buffer_);
+  segment_size_ = buffer_.size();
+
+  // Each segment can be decoded on its own.
+  loggers_.clear();
+  call_sites_.clear();
+  previous_time_ = 0;
+}
+
+void BinaryLogSink::Rotate() {
+  file_.close();
+  {
+    const std::scoped_lock lock(compress_mutex_);
+    to_compress_.push_back(SegmentPath(segment_));
+  }
+  compress_ready_.notify_one();
+
+  ++segment_;
+  OpenSegment();
+  RemoveOldSegments();
+}
+
+void BinaryLogSink::RemoveOldSegments() const {
+  if (segment_ <= max_segments_) {
+    return;
+  }
+  const auto oldest = segment_ - max_segments_ + 1;
+  std::error_code error;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(Directory(base_), error)) {
+    const auto index = SegmentIndex(base_, entry.path());
+    if (index && *index < oldest) {
+      std::filesystem::remove(entry.path(), error);
+    }
+  }
+}
+
+void BinaryLogSink::CompressLoop() {
+  while (true) {
+    std::filesystem::path path;
+    {
+      std::unique_lock lock(compress_mutex_);
+      compress_ready_.wait(
+          lock, [this] { return stopping_ || !to_compress_.empty(); });
+      if (to_compress_.empty()) {
+        return;
+      }
+      path = std::move(to_compress_.front());
+      to_compress_.pop_front();
+    }
+    CompressSegment(path);
+  }
+}
+
+bool DecodeBinaryLog(const std::filesystem::path& path, std::ostream& out) {
+  auto data = ReadFile(path);
+  if (!data) {
+    return false;
+  }
+  if (data->starts_with(COMPRESSED_MAGIC)) {
+    size_t position = COMPRESSED_MAGIC.size();
+    uint64_t size = 0;
+    if (!GetVarint(*data, position, size)) {
+      return false;
+    }
+    auto decompressed = Decompress(
+        std::as_bytes(std::span(*data).subspan(position)), size);
+    if (!decompressed) {
+      return false;
+    }
+    data->assign(reinterpret_cast<const char*>(decompressed->data()),
+                 decompressed->size());
+  }
+  if (!data->starts_with(SEGMENT_MAGIC)) {
+    return false;
+  }
+
+  struct CallSite {
+    std::string_view file;
+    uint64_t line = 0;
+    std::string_view function;
+  };
+  std::unordered_map<uint64_t, std::string_view> loggers;
+  std::unordered_map<uint64_t, CallSite> call_sites;
+
+  const std::string_view buffer(*data);
+  size_t position = SEGMENT_MAGIC.size();
+  int64_t time = 0;
+  std::string line;
+  while (position < buffer.size()) {
+    const auto type = static_cast<RecordType>(buffer[position++]);
+    uint64_t id = 0;
+    switch (type) {
+      case RecordType::Logger: {
+        std::string_view name;
+        if (!GetVarint(buffer, position, id) ||
+            !GetString(buffer, position, name)) {
+          return false;
+        }
+        loggers[id] = name;
+        break;
+      }
+      case RecordType::CallSite: {
+        CallSite call_site;
+        if (!GetVarint(buffer, position, id) ||
+            !GetString(buffer, position, call_site.file) ||
+            !GetVarint(buffer, position, call_site.line) ||
+            !GetString(buffer, position, call_site.function)) {
+          return false;
+        }
+        call_sites[id] = call_site;
+        break;
+      }
+      case RecordType::Entry: {
+        uint64_t delta = 0;
+        uint64_t logger_id = 0;
+        uint64_t call_site_id = 0;
+        uint64_t thread_id = 0;
+        std::string_view message;
+        if (!GetVarint(buffer, position, delta) ||
+            position >= buffer.size()) {
+          return false;
+        }
+        const auto level = static_cast<uint8_t>(buffer[position++]);
+        if (level >= spdlog::level::n_levels ||
+            !GetVarint(buffer, position, logger_id) ||
+            !GetVarint(buffer, position, call_site_id) ||
+            !GetVarint(buffer, position, thread_id) ||
+            !GetString(buffer, position, message)) {
+          return false;
+        }
+        time += UnZigZag(delta);
+
+        const auto call_site = call_sites.find(call_site_id);
+        line.clear();
+        line += R"({"level":")";
+        const auto level_name = spdlog::level::to_string_view(
+            static_cast<spdlog::level::level_enum>(level));
+        line.append(level_name.data(), level_name.size());
+        line += R"(","message":")";
+        AppendJsonEscaped(line, message);
+        line += R"(","time":")";
+        line += FormatTime(time);
+        line += R"(","source":")";
+        if (call_site != call_sites.end()) {
+          AppendJsonEscaped(line, call_site->second.file);
+        }
+        line += R"(","line":)";
+        line += std::to_string(
+            call_site != call_sites.end() ? call_site->second.line : 0);
+        line += R"(,"logger":")";
+        if (const auto logger = loggers.find(logger_id);
+            logger != loggers.end()) {
+          AppendJsonEscaped(line, logger->second);
+        }
+        line += R"(","thread":)";
+        line += std::to_string(thread_id);
+        line += "}\n";
+        out << line;
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace discord_social_tui
@@ -30,11 +30,18 @@ Buttons::Buttons(const std::shared_ptr<Friends>& friends,
     OnProfileClick();
   });
 
-  dm_button_ = ftxui::Button("📨 Message", [this] {
+  SetUnreadTotal(0);
+  // The label is read by pointer, so the unread badge updates in place.
+  dm_button_ = ftxui::Button(&dm_label_, [this] {
     SPDLOG_INFO("pressed DM button");
     OnDMClick();
   });
 
+  search_button_ = ftxui::Button("🔍 Search", [this] {
+    SPDLOG_INFO("pressed search button");
+    OnSearchClick();
+  });
+
   voice_button_ = ftxui::Button("🔉 Voice", [this] {
     SPDLOG_INFO("Starting voice call...");
     OnVoiceClick();
@@ -46,7 +53,7 @@ Buttons::Buttons(const std::shared_ptr<Friends>& friends,
   });
 
   horizontal_container_ = ftxui::Container::Horizontal(
-      {profile_button_, dm_button_, voice_button_});
+      {profile_button_, dm_button_, search_button_, voice_button_});
 
   // when voice state changes, update the buttons
   voice_->AddChangeHandler([this]() { VoiceChanged(); });
@@ -77,6 +84,13 @@ void Buttons::VoiceChanged() const {
   }
 }
 
+void Buttons::SetUnreadTotal(const uint64_t total) {
+  dm_label_ = "📨 Message";
+  if (total > 0) {
+    dm_label_ += " (" + std::to_string(total) + ")";
+  }
+}
+
 void Buttons::AddDMClickHandler(std::function<void()> handler) {
   dm_click_handlers_.push_back(std::move(handler));
 }
@@ -85,6 +99,10 @@ void Buttons::AddProfileClickHandler(std::function<void()> handler) {
   profile_click_handlers_.push_back(std::move(handler));
 }
 
+void Buttons::AddSearchClickHandler(std::function<void()> handler) {
+  search_click_handlers_.push_back(std::move(handler));
+}
+
 void Buttons::AddVoiceClickHandler(std::function<void()> handler) {
   voice_click_handlers_.push_back(std::move(handler));
 }
@@ -105,6 +123,12 @@ void Buttons::OnProfileClick() const {
   }
 }
 
+void Buttons::OnSearchClick() const {
+  for (const auto& handler : search_click_handlers_) {
+    handler();
+  }
+}
+
 void Buttons::OnVoiceClick() const {
   for (const auto& handler : voice_click_handlers_) {
     handler();
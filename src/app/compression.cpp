@@ -0,0 +1,186 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace discord_social_tui {
+
+namespace {
+
+// Each sequence is a token byte, literals, then a back-reference. The token
+// holds the literal and match lengths in a nibble each, with 15 meaning
+// more length bytes follow.
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t LENGTH_MASK = 15;
+constexpr size_t MAX_OFFSET = 65535;
+// As in LZ4, matches stop short of the end of the block, which is always
+// left as literals.
+constexpr size_t LAST_LITERALS = 5;
+constexpr size_t MATCH_LIMIT = 12;
+
+constexpr uint32_t HASH_BITS = 12;
+
+uint32_t Read32(const std::byte* data) {
+  uint32_t value = 0;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+uint32_t Hash(const uint32_t sequence) {
+  constexpr uint32_t MULTIPLIER = 2654435761U;
+  return (sequence * MULTIPLIER) >> (32 - HASH_BITS);
+}
+
+void PutLength(std::vector<std::byte>& out, size_t length) {
+  while (length >= 255) {
+    out.push_back(std::byte{255});
+    length -= 255;
+  }
+  out.push_back(static_cast<std::byte>(length));
+}
+
+void PutSequence(std::vector<std::byte>& out,
+                 const std::span<const std::byte> literals,
+                 const size_t match_length, const size_t offset) {
+  const auto extra_match = match_length - MIN_MATCH;
+  const auto token =
+      (std::min(literals.size(), LENGTH_MASK) << 4U) |
+      (match_length == 0 ? 0 : std::min(extra_match, LENGTH_MASK));
+  out.push_back(static_cast<std::byte>(token));
+  if (literals.size() >= LENGTH_MASK) {
+    PutLength(out, literals.size() - LENGTH_MASK);
+  }
+  out.insert(out.end(), literals.begin(), literals.end());
+  if (match_length == 0) {
+    return;
+  }
+  out.push_back(static_cast<std::byte>(offset & 0xFFU));
+  out.push_back(static_cast<std::byte>(offset >> 8U));
+  if (extra_match >= LENGTH_MASK) {
+    PutLength(out, extra_match - LENGTH_MASK);
+  }
+}
+
+// Reads the rest of a length that didn't fit in its nibble.
+bool GetLength(const std::span<const std::byte> block, size_t& position,
+               size_t& length) {
+  uint8_t byte = 255;
+  while (byte == 255) {
+    if (position >= block.size()) {
+      return false;
+    }
+    byte = static_cast<uint8_t>(block[position++]);
+    length += byte;
+  }
+  return true;
+}
+
+}  // namespace
+
+std::vector<std::byte> Compress(const std::span<const std::byte> data) {
+  std::vector<std::byte> out;
+  out.reserve(data.size() / 2);
+
+  size_t anchor = 0;
+  if (data.size() > MATCH_LIMIT) {
+    // Most recent position of each hashed 4 byte sequence
+    std::array<uint32_t, 1U << HASH_BITS> table{};
+    const auto limit = data.size() - MATCH_LIMIT;
+    const auto match_end = data.size() - LAST_LITERALS;
+    size_t position = 0;
+    while (position < limit) {
+      const auto sequence = Read32(data.data() + position);
+      auto& entry = table[Hash(sequence)];
+      const size_t candidate = entry;
+      entry = static_cast<uint32_t>(position);
+      if (candidate >= position || position - candidate > MAX_OFFSET ||
+          Read32(data.data() + candidate) != sequence) {
+        ++position;
+        continue;
+      }
+
+      auto length = MIN_MATCH;
+      while (position + length < match_end &&
+             data[candidate + length] == data[position + length]) {
+        ++length;
+      }
+      PutSequence(out, data.subspan(anchor, position - anchor), length,
+                  position - candidate);
+      position += length;
+      anchor = position;
+    }
+  }
+  PutSequence(out, data.subspan(anchor), 0, 0);
+  return out;
+}
+
+std::optional<std::vector<std::byte>> Decompress(
+    const std::span<const std::byte> block, const size_t size) {
+  std::vector<std::byte> out;
+  out.reserve(size);
+
+  size_t position = 0;
+  while (position < block.size()) {
+    const auto token = static_cast<uint8_t>(block[position++]);
+
+    size_t literals = token >> 4U;
+    if (literals == LENGTH_MASK && !GetLength(block, position, literals)) {
+      return std::nullopt;
+    }
+    if (block.size() - position < literals ||
+        size - out.size() < literals) {
+      return std::nullopt;
+    }
+    const auto literal = block.subspan(position, literals);
+    out.insert(out.end(), literal.begin(), literal.end());
+    position += literals;
+
+    // The last sequence has no match.
+    if (position == block.size()) {
+      break;
+    }
+
+    if (block.size() - position < 2) {
+      return std::nullopt;
+    }
+    const size_t offset = static_cast<uint8_t>(block[position]) |
+                          (static_cast<size_t>(block[position + 1]) << 8U);
+    position += 2;
+    size_t length = token & LENGTH_MASK;
+    if (length == LENGTH_MASK && !GetLength(block, position, length)) {
+      return std::nullopt;
+    }
+    length += MIN_MATCH;
+    if (offset == 0 || offset > out.size() || size - out.size() < length) {
+      return std::nullopt;
+    }
+    // Byte at a time, since a match can overlap what it's copying.
+    auto from = out.size() - offset;
+    for (size_t i = 0; i < length; ++i) {
+      out.push_back(out[from++]);
+    }
+  }
+
+  if (out.size() != size) {
+    return std::nullopt;
+  }
+  return out;
+}
+
+}  // namespace discord_social_tui
@@ -0,0 +1,399 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/connection_manager.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace discord_social_tui {
+
+namespace {
+
+// Gateway close code for a token it won't accept
+constexpr int32_t AUTHENTICATION_FAILED = 4004;
+
+// Only the token being turned away means it's no good. Anything else, like
+// the network being down, is worth trying again with the same one.
+bool IsRejected(const discordpp::ClientResult& result) {
+  if (result.Retryable()) {
+    return false;
+  }
+  switch (result.Type()) {
+    case discordpp::ErrorType::AuthorizationFailed:
+      return true;
+    case discordpp::ErrorType::HTTPError:
+      // An OAuth2 invalid_grant comes back as a bad request.
+      return result.Status() == discordpp::HttpStatusCode::BadRequest ||
+             result.Status() == discordpp::HttpStatusCode::Unauthorized ||
+             result.Status() == discordpp::HttpStatusCode::Forbidden;
+    default:
+      return false;
+  }
+}
+
+bool IsRejected(const discordpp::Client::Error error,
+                const int32_t error_detail) {
+  return error == discordpp::Client::Error::UnexpectedClose &&
+         error_detail == AUTHENTICATION_FAILED;
+}
+
+}  // namespace
+
+ConnectionManager::ConnectionManager(std::shared_ptr<discordpp::Client> client,
+                                     const uint64_t application_id,
+                                     std::shared_ptr<TokenStore> token_store)
+    : client_(std::move(client)),
+      application_id_(application_id),
+      token_store_(std::move(token_store)) {}
+
+void ConnectionManager::Start() {
+  started_ = Clock::now();
+  authorizing_ = true;
+  client_->SetStatusChangedCallback(
+      [this](const Status status, const discordpp::Client::Error error,
+             const int32_t error_detail) {
+        OnStatusChanged(status, error, error_detail);
+      });
+
+  // Go straight to connecting if we still have a usable token from last
+  // time, only sending the user to the browser when we have to.
+  token_ = token_store_->Load();
+  if (!token_) {
+    AuthorizeInBrowser();
+    return;
+  }
+  if (token_->ExpiresWithin(REFRESH_MARGIN)) {
+    SPDLOG_INFO("Stored access token has expired, refreshing it");
+    RefreshToken(true);
+    return;
+  }
+  SPDLOG_INFO("Using stored access token");
+  UseToken(TokenSource::Stored, true);
+}
+
+void ConnectionManager::Tick() {
+  const auto now = Clock::now();
+
+  if (authorize_at_ && now >= *authorize_at_) {
+    authorize_at_.reset();
+    AuthorizeInBrowser();
+  }
+
+  if (reconnect_at_ && now >= *reconnect_at_) {
+    reconnect_at_.reset();
+    ++reconnect_attempts_;
+    SPDLOG_INFO("Reconnecting, attempt {}", reconnect_attempts_);
+    // The token may well have run out while we were away.
+    if (token_ && token_->ExpiresWithin(REFRESH_MARGIN)) {
+      if (refreshing_) {
+        connect_after_refresh_ = true;
+      } else {
+        RefreshToken(true);
+      }
+    } else if (token_) {
+      // Hand it over again, in case it never got as far as the client.
+      UseToken(token_source_, true);
+    } else {
+      client_->Connect();
+    }
+  }
+
+  // Refresh ahead of time, so the connection never has an expired token.
+  // Keep at it through an outage, so there's a fresh one to come back with.
+  if (ready_ && token_ && !refreshing_ &&
+      !token_->refresh_token.empty() &&
+      token_->ExpiresWithin(REFRESH_MARGIN) &&
+      (!refresh_retry_at_ || now >= *refresh_retry_at_)) {
+    refresh_retry_at_.reset();
+    SPDLOG_INFO("Access token expires soon, refreshing it");
+    RefreshToken(false);
+  }
+}
+
+void ConnectionManager::AddStatusChangeHandler(
+    std::function<void(Status status)> handler) {
+  status_change_handlers_.push_back(std::move(handler));
+}
+
+void ConnectionManager::AddReadyHandler(
+    std::function<void(bool first)> handler) {
+  ready_handlers_.push_back(std::move(handler));
+}
+
+void ConnectionManager::OnStatusChanged(const Status status,
+                                        const discordpp::Client::Error error,
+                                        const int32_t error_detail) {
+  SPDLOG_INFO("Social SDK Status Change: {}",
+              discordpp::Client::StatusToString(status));
+  if (error != discordpp::Client::Error::None) {
+    SPDLOG_ERROR("Social SDK Status Error: {}, Details: {}",
+                 discordpp::Client::ErrorToString(error), error_detail);
+  }
+
+  status_ = status;
+  for (const auto& handler : status_change_handlers_) {
+    handler(status);
+  }
+
+  if (status == Status::Ready) {
+    OnReady();
+    return;
+  }
+
+  if (!ready_) {
+    // Never having got as far as ready, the token may be to blame, but
+    // only if it was turned away; otherwise just try again.
+    if (status == Status::Disconnected &&
+        error != discordpp::Client::Error::None) {
+      if (IsRejected(error, error_detail)) {
+        OnConnectFailed();
+      } else {
+        ScheduleReconnect();
+      }
+    }
+    return;
+  }
+
+  if (!outage_started_) {
+    outage_started_ = Clock::now();
+    SPDLOG_WARN("Connection lost ({})",
+                discordpp::Client::StatusToString(status));
+  }
+  // The SDK retries on its own while reconnecting, but once disconnected
+  // it is up to us.
+  if (status == Status::Disconnected) {
+    ScheduleReconnect();
+  }
+}
+
+void ConnectionManager::OnReady() {
+  const auto now = Clock::now();
+  reconnect_at_.reset();
+  backoff_ = INITIAL_BACKOFF;
+  reconnect_attempts_ = 0;
+  browser_attempts_ = 0;
+  authorizing_ = false;
+
+  const bool first = !ready_;
+  if (first) {
+    ready_ = true;
+    SPDLOG_INFO("Ready {} after starting, with a {} access token",
+                FormatDuration(now - started_),
+                token_source_ == TokenSource::Stored      ? "stored"
+                : token_source_ == TokenSource::Refreshed ? "refreshed"
+                                                          : "new");
+  } else if (outage_started_) {
+    const auto outage = now - *outage_started_;
+    outage_latency_.Record(outage);
+    SPDLOG_INFO("Usable again after a {} outage (outages: {})",
+                FormatDuration(outage), outage_latency_.Summary());
+  }
+  outage_started_.reset();
+
+  for (const auto& handler : ready_handlers_) {
+    handler(first);
+  }
+}
+
+void ConnectionManager::AuthorizeInBrowser() {
+  authorizing_ = true;
+  waiting_for_browser_ = true;
+
+  // Generate OAuth2 code verifier for authentication
+  auto code_verifier = client_->CreateAuthorizationCodeVerifier();
+
+  // Set up authentication arguments
+  discordpp::AuthorizationArgs args{};
+  args.SetClientId(application_id_);
+  args.SetScopes(discordpp::Client::GetDefaultCommunicationScopes());
+  args.SetCodeChallenge(code_verifier.Challenge());
+
+  // Begin authentication process
+  client_->Authorize(args, [this, code_verifier](
+                               const discordpp::ClientResult& result,
+                               const std::string& code,
+                               const std::string& redirect_uri) {
+    waiting_for_browser_ = false;
+    if (!result.Successful()) {
+      SPDLOG_ERROR("Authorization failed: {}", result.Error());
+      authorizing_ = false;
+      return;
+    }
+
+    SPDLOG_INFO("Authorization successful, exchanging code for token");
+
+    // Exchange auth code for access token
+    client_->GetToken(
+        application_id_, code, code_verifier.Verifier(), redirect_uri,
+        [this](
+            const discordpp::ClientResult& result,
+            const std::string&  // NOLINT(bugprone-easily-swappable-parameters)
+                access_token,
+            const std::string&  // NOLINT(bugprone-easily-swappable-parameters)
+                refresh_token,
+            const discordpp::AuthorizationTokenType token_type,
+            const int32_t expires_in, const std::string& /*scope*/) {
+          if (!result.Successful()) {
+            SPDLOG_ERROR("Token exchange failed: {}", result.Error());
+            authorizing_ = false;
+            return;
+          }
+          OnTokenExchanged(TokenSource::Browser, access_token, refresh_token,
+                           token_type, expires_in, true);
+        });
+  });
+}
+
+void ConnectionManager::RefreshToken(const bool connect) {
+  if (!token_ || token_->refresh_token.empty()) {
+    if (connect) {
+      AuthorizeInBrowser();
+    }
+    return;
+  }
+
+  refreshing_ = true;
+  client_->RefreshToken(
+      application_id_, token_->refresh_token,
+      [this, connect](
+          const discordpp::ClientResult& result,
+          const std::string&  // NOLINT(bugprone-easily-swappable-parameters)
+              access_token,
+          const std::string&  // NOLINT(bugprone-easily-swappable-parameters)
+              refresh_token,
+          const discordpp::AuthorizationTokenType token_type,
+          const int32_t expires_in, const std::string& /*scope*/) {
+        refreshing_ = false;
+        const bool should_connect =
+            connect || std::exchange(connect_after_refresh_, false);
+        if (!result.Successful()) {
+          if (IsRejected(result)) {
+            // Revoked, so there's nothing for it but the browser. A
+            // connected client carries on until the access token runs out.
+            SPDLOG_WARN("Refresh token was rejected: {}", result.Error());
+            token_store_->Clear();
+            token_.reset();
+            if (should_connect) {
+              AuthorizeInBrowser();
+            }
+            return;
+          }
+          // Most likely the network, so keep the token and try again.
+          SPDLOG_WARN("Token refresh failed, will retry: {}", result.Error());
+          if (should_connect) {
+            ScheduleReconnect();
+          } else {
+            refresh_retry_at_ = Clock::now() + REFRESH_RETRY;
+          }
+          return;
+        }
+        OnTokenExchanged(TokenSource::Refreshed, access_token, refresh_token,
+                         token_type, expires_in, should_connect);
+      });
+}
+
+void ConnectionManager::OnTokenExchanged(
+    const TokenSource source, const std::string& access_token,
+    const std::string& refresh_token,
+    const discordpp::AuthorizationTokenType token_type,
+    const int32_t expires_in, const bool connect) {
+  SPDLOG_INFO("Token exchange successful, access token expires in {} seconds",
+              expires_in);
+
+  token_ = StoredToken{
+      .access_token = access_token,
+      .refresh_token = refresh_token,
+      .token_type = token_type,
+      .expires_at = std::chrono::system_clock::now() +
+                    std::chrono::seconds(expires_in),
+  };
+  token_store_->Save(*token_);
+  UseToken(source, connect);
+}
+
+void ConnectionManager::UseToken(const TokenSource source,
+                                 const bool connect) {
+  token_source_ = source;
+  // Set the authentication token for the client. A connected client just
+  // carries on with the new one.
+  client_->UpdateToken(token_->token_type, token_->access_token,
+                       [this, connect](const discordpp::ClientResult& result) {
+                         if (!result.Successful()) {
+                           SPDLOG_ERROR("Token update failed: {}",
+                                        result.Error());
+                           if (connect) {
+                             if (IsRejected(result)) {
+                               OnConnectFailed();
+                             } else {
+                               ScheduleReconnect();
+                             }
+                           }
+                           return;
+                         }
+                         if (connect) {
+                           SPDLOG_INFO("Connection Social SDK...");
+                           client_->Connect();
+                         }
+                       });
+}
+
+// A token that was good enough to try may still be turned away, e.g. if
+// it has been revoked since it was stored. Work back towards the browser.
+// Only called once it has been, never for a transient failure.
+void ConnectionManager::OnConnectFailed() {
+  // Only the first failure for a token counts, until another is tried.
+  const auto source = std::exchange(token_source_, TokenSource::Browser);
+  switch (source) {
+    case TokenSource::Stored:
+      SPDLOG_WARN("Stored access token was not accepted, refreshing it");
+      RefreshToken(true);
+      break;
+    case TokenSource::Refreshed:
+      SPDLOG_WARN("Refreshed access token was not accepted, authorizing");
+      token_store_->Clear();
+      token_.reset();
+      AuthorizeInBrowser();
+      break;
+    case TokenSource::Browser:
+      // Even a brand new token was turned away. Send the user back to the
+      // browser a few times, backing off, then give up.
+      token_store_->Clear();
+      token_.reset();
+      if (++browser_attempts_ >= MAX_BROWSER_ATTEMPTS) {
+        SPDLOG_ERROR("New access token was not accepted {} times, giving up",
+                     browser_attempts_);
+        authorizing_ = false;
+        break;
+      }
+      SPDLOG_WARN("New access token was not accepted, authorizing again in {}",
+                  FormatDuration(backoff_));
+      authorize_at_ = Clock::now() + backoff_;
+      backoff_ = std::min(backoff_ * 2, MAX_BACKOFF);
+      break;
+  }
+}
+
+void ConnectionManager::ScheduleReconnect() {
+  if (reconnect_at_) {
+    return;
+  }
+  SPDLOG_INFO("Reconnecting in {}", FormatDuration(backoff_));
+  reconnect_at_ = Clock::now() + backoff_;
+  backoff_ = std::min(backoff_ * 2, MAX_BACKOFF);
+}
+
+}  // namespace discord_social_tui
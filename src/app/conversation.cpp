@@ -0,0 +1,320 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/conversation.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <utility>
+
+#include "app/compression.hpp"
+
+namespace discord_social_tui {
+
+namespace {
+
+// Messages are packed as varints, with each ID stored as the difference
+// from the one before, which keeps them small for the compressor.
+void PutVarint(std::vector<std::byte>& buffer, uint64_t value) {
+  while (value >= 0x80U) {
+    buffer.push_back(static_cast<std::byte>((value & 0x7FU) | 0x80U));
+    value >>= 7U;
+  }
+  buffer.push_back(static_cast<std::byte>(value));
+}
+
+void PutString(std::vector<std::byte>& buffer, const std::string& value) {
+  PutVarint(buffer, value.size());
+  const auto* data = reinterpret_cast<const std::byte*>(value.data());
+  buffer.insert(buffer.end(), data, data + value.size());
+}
+
+bool GetVarint(const std::span<const std::byte> buffer, size_t& position,
+               uint64_t& value) {
+  value = 0;
+  for (uint32_t shift = 0; shift < 64 && position < buffer.size();
+       shift += 7) {
+    const auto byte = static_cast<uint64_t>(buffer[position++]);
+    value |= (byte & 0x7FU) << shift;
+    if ((byte & 0x80U) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool GetString(const std::span<const std::byte> buffer, size_t& position,
+               std::string& value) {
+  uint64_t length = 0;
+  if (!GetVarint(buffer, position, length) ||
+      buffer.size() - position < length) {
+    return false;
+  }
+  value.assign(reinterpret_cast<const char*>(buffer.data() + position),
+               length);
+  position += length;
+  return true;
+}
+
+void PutRecord(std::vector<std::byte>& buffer, const MessageRecord& record,
+               const uint64_t previous_id) {
+  PutVarint(buffer, record.id - previous_id);
+  PutVarint(buffer, record.conversation_id);
+  PutVarint(buffer, record.author_id);
+  PutVarint(buffer, record.sent_timestamp);
+  PutString(buffer, record.author_name);
+  PutString(buffer, record.content);
+  PutVarint(buffer, record.sanitized ? 1 : 0);
+  PutVarint(buffer, record.spans.size());
+  for (const auto& span : record.spans) {
+    PutVarint(buffer, span.offset);
+    PutVarint(buffer, span.length);
+    PutVarint(buffer, span.style);
+    PutVarint(buffer, span.user_id);
+  }
+}
+
+bool GetRecord(const std::span<const std::byte> buffer, size_t& position,
+               const uint64_t previous_id, MessageRecord& record) {
+  uint64_t id_delta = 0;
+  uint64_t sanitized = 0;
+  uint64_t span_count = 0;
+  if (!GetVarint(buffer, position, id_delta) ||
+      !GetVarint(buffer, position, record.conversation_id) ||
+      !GetVarint(buffer, position, record.author_id) ||
+      !GetVarint(buffer, position, record.sent_timestamp) ||
+      !GetString(buffer, position, record.author_name) ||
+      !GetString(buffer, position, record.content) ||
+      !GetVarint(buffer, position, sanitized) ||
+      !GetVarint(buffer, position, span_count)) {
+    return false;
+  }
+  record.id = previous_id + id_delta;
+  record.sanitized = sanitized != 0;
+  // Each span takes at least four bytes.
+  if (span_count > (buffer.size() - position) / 4) {
+    return false;
+  }
+  record.spans.resize(span_count);
+  for (auto& span : record.spans) {
+    uint64_t offset = 0;
+    uint64_t length = 0;
+    uint64_t style = 0;
+    if (!GetVarint(buffer, position, offset) ||
+        !GetVarint(buffer, position, length) ||
+        !GetVarint(buffer, position, style) ||
+        !GetVarint(buffer, position, span.user_id) ||
+        offset + length > record.content.size()) {
+      return false;
+    }
+    span.offset = static_cast<uint32_t>(offset);
+    span.length = static_cast<uint32_t>(length);
+    span.style = static_cast<uint16_t>(style);
+  }
+  return true;
+}
+
+// Heap memory held by a string, beyond the string itself.
+size_t HeapSize(const std::string& value) {
+  return value.capacity() > std::string().capacity() ? value.capacity() + 1
+                                                     : 0;
+}
+
+}  // namespace
+
+bool Conversation::Insert(MessageRecord record) {
+  Decompress();
+  if (Contains(record.id)) {
+    return false;
+  }
+
+  const auto id = record.id;
+  const auto slot = Allocate(std::move(record));
+  // New messages are nearly always the newest, so this is nearly always an
+  // append.
+  if (order_.empty() || slots_[order_.back()].id < id) {
+    order_.push_back(slot);
+  } else {
+    order_.insert(Position(id), slot);
+  }
+  return true;
+}
+
+size_t Conversation::Merge(std::vector<MessageRecord> records) {
+  Decompress();
+  std::ranges::sort(records, {}, &MessageRecord::id);
+  const auto [first, last] =
+      std::ranges::unique(records, {}, &MessageRecord::id);
+  records.erase(first, last);
+
+  // Append what's new, then merge the two sorted runs in one pass, rather
+  // than shuffling the order along for each one.
+  const auto existing = order_.size();
+  for (auto& record : records) {
+    if (!Contains(record.id)) {
+      order_.push_back(Allocate(std::move(record)));
+    }
+  }
+  const auto by_id = [this](const uint32_t lhs, const uint32_t rhs) {
+    return slots_[lhs].id < slots_[rhs].id;
+  };
+  const auto middle = std::next(order_.begin(), static_cast<long>(existing));
+  if (middle != order_.begin() && middle != order_.end() &&
+      by_id(*middle, *std::prev(middle))) {
+    // Only the tail the batch reaches back into needs merging, and that's
+    // usually a handful of messages. The batch is sorted, so its oldest
+    // message is the first one appended.
+    const auto from = std::ranges::upper_bound(
+        order_.begin(), middle, slots_[*middle].id, {},
+        [this](const uint32_t slot) { return slots_[slot].id; });
+    std::inplace_merge(from, middle, order_.end(), by_id);
+  }
+  return order_.size() - existing;
+}
+
+bool Conversation::Update(MessageRecord record) {
+  Decompress();
+  const auto slot = index_.find(record.id);
+  if (slot == index_.end()) {
+    return false;
+  }
+  // The ID is unchanged, so it stays where it is in the order.
+  slots_[slot->second] = std::move(record);
+  return true;
+}
+
+bool Conversation::Erase(const uint64_t message_id) {
+  Decompress();
+  const auto slot = index_.find(message_id);
+  if (slot == index_.end()) {
+    return false;
+  }
+  order_.erase(Position(message_id));
+  slots_[slot->second] = {};
+  free_slots_.push_back(slot->second);
+  index_.erase(slot);
+  return true;
+}
+
+const MessageRecord* Conversation::Find(const uint64_t message_id) const {
+  const auto slot = index_.find(message_id);
+  return slot == index_.end() ? nullptr : &slots_[slot->second];
+}
+
+bool Conversation::Compress() {
+  if (compressed_ || order_.empty()) {
+    return false;
+  }
+
+  std::vector<std::byte> packed;
+  uint64_t previous_id = 0;
+  for (const auto& record : *this) {
+    PutRecord(packed, record, previous_id);
+    previous_id = record.id;
+  }
+
+  CompressedBlock block{
+      .data = discord_social_tui::Compress(packed),
+      .size = packed.size(),
+      .count = order_.size(),
+      .memory = MemoryUsage(),
+  };
+  block.data.shrink_to_fit();
+  if (block.data.size() >= block.memory) {
+    return false;
+  }
+
+  compressed_ = std::move(block);
+  slots_ = {};
+  free_slots_ = {};
+  order_ = {};
+  index_ = {};
+  return true;
+}
+
+bool Conversation::Decompress() {
+  if (!compressed_) {
+    return true;
+  }
+  const auto block = std::exchange(compressed_, std::nullopt);
+  const auto packed = discord_social_tui::Decompress(block->data, block->size);
+  if (!packed) {
+    SPDLOG_ERROR("Compressed conversation is corrupt, dropping {} messages",
+                 block->count);
+    return false;
+  }
+
+  slots_.reserve(block->count);
+  size_t position = 0;
+  uint64_t previous_id = 0;
+  while (position < packed->size()) {
+    MessageRecord record;
+    if (!GetRecord(*packed, position, previous_id, record)) {
+      SPDLOG_ERROR("Compressed conversation is corrupt, dropping {} messages",
+                   block->count);
+      slots_ = {};
+      order_ = {};
+      index_ = {};
+      return false;
+    }
+    previous_id = record.id;
+    // Packed in ID order, so they can go straight in.
+    order_.push_back(Allocate(std::move(record)));
+  }
+  return true;
+}
+
+size_t Conversation::MemoryUsage() const {
+  if (compressed_) {
+    return sizeof(*this) + compressed_->data.capacity();
+  }
+  size_t usage = sizeof(*this) + slots_.capacity() * sizeof(MessageRecord) +
+                 free_slots_.capacity() * sizeof(uint32_t) +
+                 order_.capacity() * sizeof(uint32_t);
+  for (const auto& slot : slots_) {
+    usage += HeapSize(slot.author_name) + HeapSize(slot.content) +
+             slot.spans.capacity() * sizeof(TextSpan);
+  }
+  // Each index node holds the entry and a next pointer, plus its bucket.
+  usage += index_.size() * (sizeof(std::pair<const uint64_t, uint32_t>) +
+                            sizeof(void*)) +
+           index_.bucket_count() * sizeof(void*);
+  return usage;
+}
+
+uint32_t Conversation::Allocate(MessageRecord record) {
+  uint32_t slot = 0;
+  if (free_slots_.empty()) {
+    slot = static_cast<uint32_t>(slots_.size());
+    slots_.push_back(std::move(record));
+  } else {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+    slots_[slot] = std::move(record);
+  }
+  index_[slots_[slot].id] = slot;
+  return slot;
+}
+
+std::vector<uint32_t>::iterator Conversation::Position(
+    const uint64_t message_id) {
+  return std::ranges::lower_bound(
+      order_, message_id, {},
+      [this](const uint32_t slot) { return slots_[slot].id; });
+}
+
+}  // namespace discord_social_tui
@@ -17,36 +17,57 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
-
+#include <array>
+#include <chrono>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include "app/friends_snapshot.hpp"
+#include "app/logging.hpp"
 #include "app/messages.hpp"
+#include "app/stats.hpp"
 #include "app/voice.hpp"
 #include "ftxui/component/component.hpp"
 #include "ftxui/component/event.hpp"
 
 namespace discord_social_tui {
 
-Friend::Friend(discordpp::UserHandle user_handle,
-               std::shared_ptr<Messages> messages, std::shared_ptr<Voice> voice,
-               const discordpp::RelationshipGroupType group_type)
-    : user_handle_(std::move(user_handle)),
-      messages_(std::move(messages)),
-      voice_(std::move(voice)),
-      group_type_(group_type) {}
+namespace {
 
-uint64_t Friend::GetId() const { return user_handle_.Id(); }
+// Friends log at their own level, e.g. SPDLOG_LEVEL=info,friends=debug
+spdlog::logger* Log() {
+  static const auto logger = Logger("friends");
+  return logger.get();
+}
 
-std::string Friend::GetUsername() const { return user_handle_.Username(); }
+}  // namespace
 
-std::string Friend::GetDisplayName() const {
-  if (auto display_name = user_handle_.DisplayName(); !display_name.empty()) {
-    return display_name;
-  }
-  // Fall back to username if display name is not available
-  return GetUsername();
+Friend::Friend(discordpp::UserHandle user_handle,
+               std::shared_ptr<Messages> messages, std::shared_ptr<Voice> voice,
+               std::shared_ptr<Names> names,
+               const discordpp::RelationshipGroupType group_type)
+    : Friend(user_handle.Id(), user_handle.Username(),
+             user_handle.DisplayName(), user_handle.Status(),
+             std::move(messages), std::move(voice), std::move(names),
+             group_type) {
+  user_handle_ = std::move(user_handle);
 }
 
-discordpp::StatusType Friend::GetStatus() const {
-  return user_handle_.Status();
+Friend::Friend(const uint64_t user_id, const std::string_view username,
+               const std::string_view display_name,
+               const discordpp::StatusType status,
+               std::shared_ptr<Messages> messages, std::shared_ptr<Voice> voice,
+               std::shared_ptr<Names> names,
+               const discordpp::RelationshipGroupType group_type)
+    : id_(user_id),
+      status_(status),
+      messages_(std::move(messages)),
+      voice_(std::move(voice)),
+      names_(std::move(names)),
+      group_type_(group_type) {
+  names_->Update(id_, username, display_name);
+  RefreshLabel();
 }
 
 discordpp::RelationshipGroupType Friend::GetGroupType() const {
@@ -82,21 +103,36 @@ std::string Friend::GetFormattedDisplayName() const {
     status_emoji += "🔉";
   }
 
-  if (messages_->HasUnreadMessages(GetId())) {
-    status_emoji += "📨";
+  if (const auto unread = messages_->UnreadCount(GetId()); unread > 0) {
+    status_emoji += "📨" + std::to_string(unread);
   }
 
-  return status_emoji + " " + GetDisplayName();
+  return status_emoji.append(" ").append(GetDisplayName());
+}
+
+void Friend::RefreshLabel() { label_ = GetFormattedDisplayName(); }
+
+bool Friend::Update(const Friend& latest) {
+  status_ = latest.status_;
+  user_handle_ = latest.user_handle_;
+  // Names are shared, so the latest has already renamed us.
+  auto label = GetFormattedDisplayName();
+  if (label == label_) {
+    return false;
+  }
+  label_ = std::move(label);
+  return true;
 }
 
 Friends::Friends(std::shared_ptr<discordpp::Client> client,
                  std::shared_ptr<Messages> messages,
-                 std::shared_ptr<Voice> voice)
+                 std::shared_ptr<Voice> voice, std::shared_ptr<Names> names)
     : menu_entries_(ftxui::Container::Vertical(std::vector<ftxui::Component>{},
                                                &selected_index_)),
       client_(std::move(client)),
       messages_(std::move(messages)),
-      voice_(std::move(voice)) {
+      voice_(std::move(voice)),
+      names_(std::move(names)) {
   // Re-wrap with OnEvent handler and scrolling
   this->menu_component_ =
       menu_entries_ | ftxui::CatchEvent([this](const ftxui::Event&) -> bool {
@@ -119,22 +155,17 @@ std::optional<std::shared_ptr<Friend>> Friends::GetFriendAt(
 }
 
 std::optional<std::shared_ptr<Friend>> Friends::GetFriendById(
-    uint64_t user_id) {
-  const auto iterator =
-      std::ranges::find_if(friends_, [user_id](const auto& friend_opt) {
-        return friend_opt.has_value() && friend_opt.value()->GetId() == user_id;
-      });
-
-  return (iterator != friends_.end()) ? *iterator : std::nullopt;
+    uint64_t user_id) const {
+  const auto index = friend_indexes_.find(user_id);
+  return index == friend_indexes_.end() ? std::nullopt
+                                        : friends_[index->second];
 }
 
 void Friends::SetSelectedIndexByFriendId(uint64_t user_id) {
-  for (size_t i = 0; i < friends_.size(); ++i) {
-    if (auto friend_ = friends_[i];
-        friend_ && friend_.value()->GetId() == user_id) {
-      selected_index_ = static_cast<int>(i);
-      return;
-    }
+  if (const auto index = friend_indexes_.find(user_id);
+      index != friend_indexes_.end()) {
+    selected_index_ = static_cast<int>(index->second);
+    return;
   }
   // If friend is not found, keep the current selection
   spdlog::warn("Friend with ID {} not found, keeping current selection",
@@ -155,14 +186,94 @@ void Friends::Run() {
   // Set up the unified friends list update callback
   client_->SetRelationshipGroupsUpdatedCallback(
       [this](const uint64_t _user_id) { Refresh(); });
-  voice_->AddChangeHandler([this] { Refresh(); });
-  messages_->AddUnreadChangeHandler([this] { Refresh(); });
+  // Keep names current, so renames show without rebuilding the list.
+  client_->SetUserUpdatedCallback([this](const uint64_t user_id) {
+    const auto user = client_->GetUser(user_id);
+    if (!user ||
+        !names_->Update(user_id, user->Username(), user->DisplayName())) {
+      return;
+    }
+    SPDLOG_LOGGER_DEBUG(Log(), "Names changed for user {}", user_id);
+    if (const auto friend_ = GetFriendById(user_id)) {
+      friend_.value()->RefreshLabel();
+    }
+  });
+  // Calls and unread messages only change labels, not who is in the list.
+  voice_->AddChangeHandler([this] { RefreshLabels(); });
+  messages_->AddUnreadChangeHandler(
+      [this](const std::span<const uint64_t> user_ids) {
+        for (const auto user_id : user_ids) {
+          if (const auto friend_ = GetFriendById(user_id)) {
+            friend_.value()->RefreshLabel();
+          }
+        }
+      });
 }
 
 void Friends::Refresh() {
-  SPDLOG_INFO("Refreshing friends list");
+  // Every relationship change rebuilds the list, so these come in bursts.
+  LOG_PER_SECOND(Log(), spdlog::level::info, 1, "Refreshing friends list");
   if (!menu_entries_) {
-    SPDLOG_WARN("Cannot refresh friends list: menu component not yet created");
+    SPDLOG_LOGGER_WARN(
+        Log(), "Cannot refresh friends list: menu component not yet created");
+    return;
+  }
+  // Until we're connected, the last run's list is better than an empty one.
+  if (stale_ && client_->GetStatus() != discordpp::Client::Status::Ready) {
+    return;
+  }
+  stale_ = false;
+
+  std::vector<std::shared_ptr<Friend>> friends;
+  for (const auto group : {discordpp::RelationshipGroupType::OnlinePlayingGame,
+                           discordpp::RelationshipGroupType::OnlineElsewhere,
+                           discordpp::RelationshipGroupType::Offline}) {
+    for (const auto& relationship : client_->GetRelationshipsByGroup(group)) {
+      if (auto user = relationship.User()) {
+        friends.push_back(std::make_shared<Friend>(user.value(), messages_,
+                                                   voice_, names_, group));
+      }
+    }
+  }
+  Merge(friends);
+}
+
+void Friends::Merge(const std::vector<std::shared_ptr<Friend>>& latest) {
+  // Walk the new list alongside the current one. While they agree, the
+  // entries can stay as they are.
+  std::vector<std::shared_ptr<Friend>> friends;
+  friends.reserve(latest.size());
+  bool changed = latest.size() != friend_indexes_.size();
+  size_t position = 0;
+  size_t updated = 0;
+  for (const auto& friend_ : latest) {
+    while (position < friends_.size() && !friends_[position]) {
+      ++position;  // Skip headers
+    }
+    const auto existing = GetFriendById(friend_->GetId());
+    if (existing &&
+        existing.value()->GetGroupType() == friend_->GetGroupType()) {
+      updated += existing.value()->Update(*friend_) ? 1 : 0;
+      friends.push_back(existing.value());
+    } else {
+      friends.push_back(friend_);
+    }
+    changed = changed || position >= friends_.size() ||
+              friends_[position] != friends.back();
+    ++position;
+  }
+  LOG_PER_SECOND(Log(), spdlog::level::debug, 1,
+                 "Friends list {}, {} friends updated",
+                 changed ? "rebuilt" : "unchanged", updated);
+  if (changed) {
+    SetFriends(friends);
+  }
+}
+
+void Friends::SetFriends(const std::vector<std::shared_ptr<Friend>>& friends) {
+  if (!menu_entries_) {
+    SPDLOG_LOGGER_WARN(
+        Log(), "Cannot set friends list: menu component not yet created");
     return;
   }
 
@@ -173,65 +284,100 @@ void Friends::Refresh() {
           })
           .value_or(-1);
 
-  const auto online_playing = client_->GetRelationshipsByGroup(
-      discordpp::RelationshipGroupType::OnlinePlayingGame);
-  const auto online_elsewhere = client_->GetRelationshipsByGroup(
-      discordpp::RelationshipGroupType::OnlineElsewhere);
-  const auto offline = client_->GetRelationshipsByGroup(
-      discordpp::RelationshipGroupType::Offline);
-
   // rebuild friends, so we can find them again.
   friends_.clear();
+  friend_indexes_.clear();
   // Remove all menu entries and rebuild!
   menu_entries_->DetachAllChildren();
 
-  // Add "Online Playing" header
-  menu_entries_->Add(
-      ftxui::Renderer([] { return ftxui::text("Online Playing"); }));
-  friends_.emplace_back(std::nullopt);  // Header position
-
-  for (const auto& relationship : online_playing) {
-    if (auto user = relationship.User()) {
-      auto friend_ = std::make_shared<Friend>(
-          user.value(), messages_, voice_,
-          discordpp::RelationshipGroupType::OnlinePlayingGame);
-      menu_entries_->Add(ftxui::MenuEntry(*friend_));
-      friends_.emplace_back(std::move(friend_));
+  constexpr std::array<
+      std::pair<discordpp::RelationshipGroupType, std::string_view>, 3>
+      GROUPS = {{
+          {discordpp::RelationshipGroupType::OnlinePlayingGame,
+           "Online Playing"},
+          {discordpp::RelationshipGroupType::OnlineElsewhere,
+           "Online Elsewhere"},
+          {discordpp::RelationshipGroupType::Offline, "Offline"},
+      }};
+  for (const auto& [group, title] : GROUPS) {
+    menu_entries_->Add(ftxui::Renderer([this, title] {
+      return ftxui::text(std::string(title) + (stale_ ? " (cached)" : ""));
+    }));
+    friends_.emplace_back(std::nullopt);  // Header position
+
+    for (const auto& friend_ : friends) {
+      if (friend_->GetGroupType() == group) {
+        friend_indexes_[friend_->GetId()] = friends_.size();
+        // The entry reads the friend's label by pointer, so label updates
+        // don't need a rebuild.
+        menu_entries_->Add(ftxui::MenuEntry(*friend_));
+        friends_.emplace_back(friend_);
+      }
     }
   }
 
-  // Add "Online Elsewhere" header
-  menu_entries_->Add(
-      ftxui::Renderer([] { return ftxui::text("Online Elsewhere"); }));
-  friends_.emplace_back(std::nullopt);  // Header position
+  // keep pointing at the same person
+  if (selected_id > 0) {
+    SetSelectedIndexByFriendId(selected_id);
+  }
+}
 
-  for (const auto& relationship : online_elsewhere) {
-    if (auto user = relationship.User()) {
-      auto friend_ = std::make_shared<Friend>(
-          user.value(), messages_, voice_,
-          discordpp::RelationshipGroupType::OnlineElsewhere);
-      menu_entries_->Add(ftxui::MenuEntry(*friend_));
-      friends_.emplace_back(std::move(friend_));
-    }
+bool Friends::LoadSnapshot(const std::filesystem::path& path) {
+  const auto started = std::chrono::steady_clock::now();
+  const auto snapshot = FriendsSnapshot::Open(path);
+  if (!snapshot) {
+    return false;
   }
 
-  // Add "Offline" header
-  menu_entries_->Add(ftxui::Renderer([] { return ftxui::text("Offline"); }));
-  friends_.emplace_back(std::nullopt);  // Header position
+  std::vector<std::shared_ptr<Friend>> friends;
+  friends.reserve(snapshot->size());
+  for (size_t i = 0; i < snapshot->size(); ++i) {
+    const auto entry = (*snapshot)[i];
+    // Before the friend, so their label shows it.
+    messages_->RestoreUnread(entry.user_id, entry.unread);
+    // Names are interned, so nothing refers to the mapping once it's gone.
+    friends.push_back(std::make_shared<Friend>(
+        entry.user_id, entry.username, entry.display_name, entry.status,
+        messages_, voice_, names_, entry.group_type));
+  }
+  stale_ = true;
+  SetFriends(friends);
+  SPDLOG_LOGGER_INFO(
+      Log(), "Showing {} friends from the last run, loaded in {}",
+      friends.size(),
+      FormatDuration(std::chrono::steady_clock::now() - started));
+  return true;
+}
 
-  for (const auto& relationship : offline) {
-    if (auto user = relationship.User()) {
-      auto friend_ =
-          std::make_shared<Friend>(user.value(), messages_, voice_,
-                                   discordpp::RelationshipGroupType::Offline);
-      menu_entries_->Add(ftxui::MenuEntry(*friend_));
-      friends_.emplace_back(std::move(friend_));
+void Friends::SaveSnapshot(const std::filesystem::path& path) const {
+  // Nothing has been learned since it was loaded.
+  if (stale_) {
+    return;
+  }
+  std::vector<FriendsSnapshot::Entry> entries;
+  entries.reserve(friend_indexes_.size());
+  for (const auto& friend_ : friends_) {
+    if (!friend_) {
+      continue;
     }
+    const auto& value = friend_.value();
+    entries.push_back({
+        .user_id = value->GetId(),
+        .username = value->GetUsername(),
+        .display_name = value->GetDisplayName(),
+        .status = value->GetStatus(),
+        .group_type = value->GetGroupType(),
+        .unread = messages_->UnreadCount(value->GetId()),
+    });
   }
+  FriendsSnapshot::Save(path, entries);
+}
 
-  // keep pointing at the same person
-  if (selected_id > 0) {
-    SetSelectedIndexByFriendId(selected_id);
+void Friends::RefreshLabels() const {
+  for (const auto& friend_ : friends_) {
+    if (friend_) {
+      friend_.value()->RefreshLabel();
+    }
   }
 }
 
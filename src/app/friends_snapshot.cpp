@@ -0,0 +1,216 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/friends_snapshot.hpp"
+
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace discord_social_tui {
+
+namespace {
+
+constexpr std::array<char, 8> SNAPSHOT_MAGIC = {'D', 'S', 'F', 'R',
+                                                'N', 'D', '0', '1'};
+
+// Header: magic, then the number of entries and a reserved word
+struct Header {
+  std::array<char, 8> magic;
+  uint32_t count;
+  uint32_t reserved;
+};
+
+// Names are stored as offsets into the string table after the entries.
+struct Record {
+  uint64_t user_id;
+  uint32_t username_offset;
+  uint32_t username_length;
+  uint32_t display_name_offset;
+  uint32_t display_name_length;
+  uint32_t unread;
+  uint8_t status;
+  uint8_t group_type;
+  uint16_t reserved;
+};
+
+static_assert(sizeof(Header) == 16);
+static_assert(sizeof(Record) == 32);
+
+template <typename T>
+T Read(const std::byte* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+std::optional<FriendsSnapshot> FriendsSnapshot::Open(
+    const std::filesystem::path& path) {
+  const int file_descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (file_descriptor < 0) {
+    return std::nullopt;
+  }
+  struct stat status{};
+  if (::fstat(file_descriptor, &status) != 0 ||
+      static_cast<size_t>(status.st_size) < sizeof(Header)) {
+    ::close(file_descriptor);
+    return std::nullopt;
+  }
+  const auto size = static_cast<size_t>(status.st_size);
+  void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+  ::close(file_descriptor);
+  if (map == MAP_FAILED) {
+    SPDLOG_WARN("Could not map friends snapshot {}: {}", path.string(),
+                std::strerror(errno));
+    return std::nullopt;
+  }
+
+  // Check everything once here, so entries can be read without checks.
+  FriendsSnapshot snapshot(static_cast<const std::byte*>(map), size, 0);
+  const auto header = Read<Header>(snapshot.map_);
+  if (header.magic != SNAPSHOT_MAGIC ||
+      (size - sizeof(Header)) / sizeof(Record) < header.count) {
+    SPDLOG_WARN("Ignoring invalid friends snapshot {}", path.string());
+    return std::nullopt;
+  }
+  const auto strings = sizeof(Header) + (header.count * sizeof(Record));
+  const auto strings_size = size - strings;
+  for (size_t i = 0; i < header.count; ++i) {
+    const auto record =
+        Read<Record>(snapshot.map_ + sizeof(Header) + (i * sizeof(Record)));
+    if (record.username_offset > strings_size ||
+        record.username_length > strings_size - record.username_offset ||
+        record.display_name_offset > strings_size ||
+        record.display_name_length >
+            strings_size - record.display_name_offset) {
+      SPDLOG_WARN("Ignoring invalid friends snapshot {}", path.string());
+      return std::nullopt;
+    }
+  }
+  snapshot.count_ = header.count;
+  return snapshot;
+}
+
+bool FriendsSnapshot::Save(const std::filesystem::path& path,
+                           const std::span<const Entry> entries) {
+  std::vector<Record> records;
+  records.reserve(entries.size());
+  std::string strings;
+  for (const auto& entry : entries) {
+    Record record{};
+    record.user_id = entry.user_id;
+    record.username_offset = static_cast<uint32_t>(strings.size());
+    record.username_length = static_cast<uint32_t>(entry.username.size());
+    strings += entry.username;
+    record.display_name_offset = static_cast<uint32_t>(strings.size());
+    record.display_name_length =
+        static_cast<uint32_t>(entry.display_name.size());
+    strings += entry.display_name;
+    record.unread = entry.unread;
+    record.status = static_cast<uint8_t>(entry.status);
+    record.group_type = static_cast<uint8_t>(entry.group_type);
+    records.push_back(record);
+  }
+  const Header header{.magic = SNAPSHOT_MAGIC,
+                      .count = static_cast<uint32_t>(records.size()),
+                      .reserved = 0};
+
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+
+  // Write to the side and rename, so a crash never leaves a half-written
+  // snapshot behind.
+  auto temporary = path;
+  temporary += ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.data()),
+               static_cast<std::streamsize>(records.size() * sizeof(Record)));
+    file.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+    if (!file) {
+      SPDLOG_ERROR("Could not write friends snapshot {}", temporary.string());
+      return false;
+    }
+  }
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    SPDLOG_ERROR("Could not save friends snapshot {}: {}", path.string(),
+                 error.message());
+    return false;
+  }
+  SPDLOG_INFO("Saved friends snapshot ({} friends)", entries.size());
+  return true;
+}
+
+FriendsSnapshot::FriendsSnapshot(const std::byte* map, const size_t size,
+                                 const size_t count)
+    : map_(map), size_(size), count_(count) {}
+
+FriendsSnapshot::~FriendsSnapshot() { Unmap(); }
+
+FriendsSnapshot::FriendsSnapshot(FriendsSnapshot&& other) noexcept
+    : map_(std::exchange(other.map_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      count_(std::exchange(other.count_, 0)) {}
+
+FriendsSnapshot& FriendsSnapshot::operator=(FriendsSnapshot&& other) noexcept {
+  if (this != &other) {
+    Unmap();
+    map_ = std::exchange(other.map_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    count_ = std::exchange(other.count_, 0);
+  }
+  return *this;
+}
+
+void FriendsSnapshot::Unmap() {
+  if (map_ != nullptr) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    ::munmap(const_cast<std::byte*>(map_), size_);
+    map_ = nullptr;
+  }
+}
+
+FriendsSnapshot::Entry FriendsSnapshot::operator[](const size_t index) const {
+  const auto record =
+      Read<Record>(map_ + sizeof(Header) + (index * sizeof(Record)));
+  const auto* strings = reinterpret_cast<const char*>(
+      map_ + sizeof(Header) + (count_ * sizeof(Record)));
+  return Entry{
+      .user_id = record.user_id,
+      .username = {strings + record.username_offset, record.username_length},
+      .display_name = {strings + record.display_name_offset,
+                       record.display_name_length},
+      .status = static_cast<discordpp::StatusType>(record.status),
+      .group_type =
+          static_cast<discordpp::RelationshipGroupType>(record.group_type),
+      .unread = record.unread,
+  };
+}
+
+}  // namespace discord_social_tui
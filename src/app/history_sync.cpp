@@ -0,0 +1,224 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/history_sync.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace discord_social_tui {
+
+HistorySync::HistorySync(std::shared_ptr<discordpp::Client> client,
+                         std::shared_ptr<MessageCache> cache,
+                         MergeHandler on_merge)
+    : client_(std::move(client)),
+      cache_(std::move(cache)),
+      on_merge_(std::move(on_merge)) {}
+
+void HistorySync::SyncAll() {
+  SPDLOG_INFO("Syncing message history");
+  sync_all_started_ = Clock::now();
+  sync_all_messages_ = 0;
+  // Anything could have been missed while we were away.
+  auto was_synced = std::exchange(synced_, {});
+
+  client_->GetUserMessageSummaries(
+      [this, was_synced = std::move(was_synced)](
+          const discordpp::ClientResult& result,
+             const std::vector<discordpp::UserMessageSummary>& summaries) {
+        if (!result.Successful()) {
+          SPDLOG_ERROR("Failed to fetch message summaries: {}", result.Error());
+          sync_all_started_.reset();
+          return;
+        }
+
+        size_t behind = 0;
+        std::unordered_set<uint64_t> summarized;
+        for (const auto& summary : summaries) {
+          const auto user_id = summary.UserId();
+          summarized.insert(user_id);
+          const auto last_seen = LastSeen(user_id);
+          // Conversations we have nothing for are fetched when first opened,
+          // unless they already were, while empty.
+          if (last_seen == 0 && !was_synced.contains(user_id)) {
+            continue;
+          }
+          if (summary.LastMessageId() > last_seen) {
+            Sync(user_id, Priority::Background);
+            ++behind;
+          } else {
+            synced_.insert(user_id);
+          }
+        }
+        // Without a summary there are still no messages at all, so an empty
+        // conversation that was synced still is.
+        for (const auto user_id : was_synced) {
+          if (!summarized.contains(user_id) && LastSeen(user_id) == 0) {
+            synced_.insert(user_id);
+          }
+        }
+        SPDLOG_INFO("{} of {} conversations have new messages", behind,
+                    summaries.size());
+        Pump();
+      });
+}
+
+void HistorySync::Sync(const uint64_t user_id, const Priority priority) {
+  if (pending_.insert(user_id).second) {
+    if (priority == Priority::Foreground) {
+      queue_.push_front(user_id);
+    } else {
+      queue_.push_back(user_id);
+    }
+    Pump();
+    return;
+  }
+
+  // Already waiting, but the user now wants it, so move it to the front.
+  if (priority == Priority::Foreground && !in_flight_.contains(user_id)) {
+    std::erase(queue_, user_id);
+    queue_.push_front(user_id);
+  }
+}
+
+bool HistorySync::IsPending(const uint64_t user_id) const {
+  return pending_.contains(user_id);
+}
+
+bool HistorySync::IsSynced(const uint64_t user_id) const {
+  return synced_.contains(user_id);
+}
+
+void HistorySync::Unsync(const uint64_t user_id) { synced_.erase(user_id); }
+
+bool HistorySync::Observe(const uint64_t user_id, const uint64_t message_id) {
+  if (!IsSynced(user_id)) {
+    // Leave a gap to be filled by the next sync, rather than skipping it.
+    return false;
+  }
+  auto& last_seen = last_seen_[user_id];
+  last_seen = std::max(last_seen, message_id);
+  return true;
+}
+
+std::optional<std::chrono::nanoseconds> HistorySync::LastLatency(
+    const uint64_t user_id) const {
+  const auto latency = last_latency_.find(user_id);
+  if (latency == last_latency_.end()) {
+    return std::nullopt;
+  }
+  return latency->second;
+}
+
+uint64_t HistorySync::LastSeen(const uint64_t user_id) const {
+  const auto last_seen = last_seen_.find(user_id);
+  return std::max(last_seen == last_seen_.end() ? 0 : last_seen->second,
+                  cache_->NewestMessageId(user_id));
+}
+
+void HistorySync::Pump() {
+  while (in_flight_.size() < MAX_IN_FLIGHT && !queue_.empty()) {
+    const auto user_id = queue_.front();
+    queue_.pop_front();
+    in_flight_.insert(user_id);
+    Fetch(user_id, LastSeen(user_id) == 0 ? FULL_LIMIT : DELTA_LIMIT,
+          Clock::now());
+  }
+
+  if (sync_all_started_ && in_flight_.empty() && queue_.empty()) {
+    SPDLOG_INFO("Message history sync fetched {} messages in {} ({})",
+                sync_all_messages_,
+                FormatDuration(Clock::now() - *sync_all_started_),
+                latency_.Summary());
+    sync_all_started_.reset();
+  }
+}
+
+void HistorySync::Fetch(const uint64_t user_id, const int32_t limit,
+                        const Clock::time_point started) {
+  client_->GetUserMessagesWithLimit(
+      user_id, limit,
+      [this, user_id, limit, started](
+          const discordpp::ClientResult& result,
+          std::vector<discordpp::MessageHandle> messages) {
+        if (!result.Successful()) {
+          SPDLOG_ERROR("Failed to fetch message history for user {}: {}",
+                       user_id, result.Error());
+          Finish(user_id, started, false);
+          return;
+        }
+
+        // Messages come back newest first. If even the oldest one is newer
+        // than what we've seen, there may be a gap, so ask for more.
+        const auto last_seen = LastSeen(user_id);
+        const bool gap = last_seen != 0 && !messages.empty() &&
+                         std::cmp_equal(messages.size(), limit) &&
+                         messages.back().Id() > last_seen;
+        if (gap && limit < MAX_LIMIT) {
+          Fetch(user_id, std::min(limit * LIMIT_GROWTH, MAX_LIMIT), started);
+          return;
+        }
+
+        std::erase_if(messages, [last_seen](const auto& message) {
+          return message.Id() <= last_seen;
+        });
+        // reverse them, because we want them in chronological order.
+        std::ranges::reverse(messages);
+        sync_all_messages_ += messages.size();
+
+        if (gap) {
+          // The SDK can't page back any further, so the gap stays. Leave
+          // the conversation unsynced, and where it was, so nothing treats
+          // what we have as complete.
+          SPDLOG_WARN("Fetched {} new messages for user {}, but more were "
+                      "missed before them",
+                      messages.size(), user_id);
+          on_merge_(user_id, messages, false);
+          Finish(user_id, started, false);
+          return;
+        }
+
+        SPDLOG_INFO("Fetched {} new messages for user {}", messages.size(),
+                    user_id);
+        if (!messages.empty()) {
+          auto& newest = last_seen_[user_id];
+          newest = std::max(newest, messages.back().Id());
+        }
+        // Mark it synced first, so the merge can treat it as contiguous.
+        synced_.insert(user_id);
+        if (!messages.empty()) {
+          on_merge_(user_id, messages, true);
+        }
+        Finish(user_id, started, true);
+      });
+}
+
+void HistorySync::Finish(const uint64_t user_id,
+                         const Clock::time_point started, const bool synced) {
+  if (synced) {
+    const auto latency = Clock::now() - started;
+    last_latency_[user_id] = latency;
+    latency_.Record(latency);
+    SPDLOG_DEBUG("Synced conversation with {} in {}", user_id,
+                 FormatDuration(latency));
+  }
+
+  pending_.erase(user_id);
+  in_flight_.erase(user_id);
+  Pump();
+}
+
+}  // namespace discord_social_tui
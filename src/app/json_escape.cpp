@@ -0,0 +1,142 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/json_escape.hpp"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace discord_social_tui {
+
+namespace {
+
+bool NeedsEscape(const unsigned char byte) {
+  return byte < 0x20 || byte == '"' || byte == '\\';
+}
+
+#if defined(__AVX2__)
+// Length of the run of bytes at the start of the text that can be copied as
+// they are.
+size_t SafeRun(const std::string_view text) {
+  // Offset so a signed compare finds bytes below 0x20, but not 0x80 and up.
+  const auto bias = _mm256_set1_epi8(static_cast<char>(0x80));
+  const auto limit = _mm256_set1_epi8(static_cast<char>(0x20 ^ 0x80));
+  const auto quote = _mm256_set1_epi8('"');
+  const auto backslash = _mm256_set1_epi8('\\');
+  size_t i = 0;
+  for (; i + sizeof(__m256i) <= text.size(); i += sizeof(__m256i)) {
+    const auto bytes = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(text.data() + i));
+    const auto escape = _mm256_or_si256(
+        _mm256_cmpgt_epi8(limit, _mm256_xor_si256(bytes, bias)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(bytes, quote),
+                        _mm256_cmpeq_epi8(bytes, backslash)));
+    if (const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(escape));
+        mask != 0) {
+      return i + static_cast<size_t>(std::countr_zero(mask));
+    }
+  }
+  while (i < text.size() && !NeedsEscape(static_cast<unsigned char>(text[i]))) {
+    ++i;
+  }
+  return i;
+}
+#elif defined(__SSE2__)
+size_t SafeRun(const std::string_view text) {
+  // Offset so a signed compare finds bytes below 0x20, but not 0x80 and up.
+  const auto bias = _mm_set1_epi8(static_cast<char>(0x80));
+  const auto limit = _mm_set1_epi8(static_cast<char>(0x20 ^ 0x80));
+  const auto quote = _mm_set1_epi8('"');
+  const auto backslash = _mm_set1_epi8('\\');
+  size_t i = 0;
+  for (; i + sizeof(__m128i) <= text.size(); i += sizeof(__m128i)) {
+    const auto bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+    const auto escape =
+        _mm_or_si128(_mm_cmplt_epi8(_mm_xor_si128(bytes, bias), limit),
+                     _mm_or_si128(_mm_cmpeq_epi8(bytes, quote),
+                                  _mm_cmpeq_epi8(bytes, backslash)));
+    if (const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(escape));
+        mask != 0) {
+      return i + static_cast<size_t>(std::countr_zero(mask));
+    }
+  }
+  while (i < text.size() && !NeedsEscape(static_cast<unsigned char>(text[i]))) {
+    ++i;
+  }
+  return i;
+}
+#else
+size_t SafeRun(const std::string_view text) {
+  size_t i = 0;
+  while (i < text.size() && !NeedsEscape(static_cast<unsigned char>(text[i]))) {
+    ++i;
+  }
+  return i;
+}
+#endif
+
+}  // namespace
+
+void AppendJsonEscaped(std::string& out, std::string_view text) {
+  static constexpr std::array<char, 16> HEX = {'0', '1', '2', '3', '4', '5',
+                                               '6', '7', '8', '9', 'a', 'b',
+                                               'c', 'd', 'e', 'f'};
+  while (!text.empty()) {
+    const auto run = SafeRun(text);
+    out.append(text.substr(0, run));
+    if (run == text.size()) {
+      return;
+    }
+
+    const auto byte = static_cast<unsigned char>(text[run]);
+    switch (byte) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\b':
+        out += "\\b";
+        break;
+      case '\f':
+        out += "\\f";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        out += "\\u00";
+        out += HEX[byte >> 4U];
+        out += HEX[byte & 0xFU];
+        break;
+    }
+    text.remove_prefix(run + 1);
+  }
+}
+
+}  // namespace discord_social_tui
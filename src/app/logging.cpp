@@ -0,0 +1,62 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/logging.hpp"
+
+#include <algorithm>
+
+namespace discord_social_tui {
+
+std::shared_ptr<spdlog::logger> Logger(const std::string& subsystem) {
+  if (auto logger = spdlog::get(subsystem)) {
+    return logger;
+  }
+  auto logger = spdlog::default_logger()->clone(subsystem);
+  // Picks up the pattern, and this subsystem's level from SPDLOG_LEVEL, and
+  // registers it so it is flushed along with the rest.
+  spdlog::initialize_logger(logger);
+  return logger;
+}
+
+LogLimiter::LogLimiter(const uint32_t every_n, const uint32_t per_second)
+    : every_n_(every_n),
+      per_second_(per_second),
+      tokens_(per_second),
+      refilled_(Clock::now()) {}
+
+std::optional<uint64_t> LogLimiter::Admit() {
+  const std::scoped_lock lock(mutex_);
+
+  if (every_n_ > 1 && seen_++ % every_n_ != 0) {
+    ++suppressed_;
+    return std::nullopt;
+  }
+
+  if (per_second_ > 0) {
+    const auto now = Clock::now();
+    const std::chrono::duration<double> elapsed = now - refilled_;
+    refilled_ = now;
+    tokens_ = std::min<double>(per_second_,
+                               tokens_ + (elapsed.count() * per_second_));
+    if (tokens_ < 1) {
+      ++suppressed_;
+      return std::nullopt;
+    }
+    --tokens_;
+  }
+
+  return std::exchange(suppressed_, 0);
+}
+
+}  // namespace discord_social_tui
@@ -0,0 +1,669 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/message_cache.hpp"
+
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+
+namespace discord_social_tui {
+
+namespace {
+
+// Segment files start with a magic number and a format version.
+constexpr std::array<char, 4> SEGMENT_MAGIC = {'D', 'S', 'M', 'C'};
+constexpr uint16_t SEGMENT_VERSION = 1;
+constexpr size_t SEGMENT_HEADER_SIZE = 8;
+
+// Each record is prefixed with the CRC32 and length of its payload.
+constexpr size_t RECORD_HEADER_SIZE = 8;
+constexpr uint8_t RECORD_TYPE_MESSAGE = 1;
+// Marks a message as deleted, superseding any earlier copies of it.
+constexpr uint8_t RECORD_TYPE_DELETED = 2;
+
+constexpr std::string_view SEGMENT_PREFIX = "segment-";
+constexpr std::string_view SEGMENT_SUFFIX = ".log";
+constexpr auto COMPACT_FILE_NAME = "compact.tmp";
+
+uint32_t Crc32(const std::byte* data, const size_t size) {
+  static const auto TABLE = [] {
+    constexpr uint32_t POLYNOMIAL = 0xEDB88320U;
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < table.size(); ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc & 1U) != 0 ? (crc >> 1U) ^ POLYNOMIAL : crc >> 1U;
+      }
+      table[i] = crc;
+    }
+    return table;
+  }();
+
+  uint32_t crc = 0xFFFFFFFFU;
+  for (size_t i = 0; i < size; ++i) {
+    crc = TABLE[(crc ^ static_cast<uint8_t>(data[i])) & 0xFFU] ^ (crc >> 8U);
+  }
+  return crc ^ 0xFFFFFFFFU;
+}
+
+// Fields are written in host byte order; the cache is never shared between
+// machines.
+template <typename T>
+void Put(std::vector<std::byte>& buffer, const T value) {
+  const auto offset = buffer.size();
+  buffer.resize(offset + sizeof(T));
+  std::memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+void PutString(std::vector<std::byte>& buffer, const std::string& value) {
+  Put(buffer, static_cast<uint32_t>(value.size()));
+  const auto offset = buffer.size();
+  buffer.resize(offset + value.size());
+  std::memcpy(buffer.data() + offset, value.data(), value.size());
+}
+
+// Reads fields back out of a payload, failing rather than reading past the
+// end.
+class Reader {
+ public:
+  Reader(const std::byte* data, const size_t size) : data_(data), size_(size) {}
+
+  template <typename T>
+  bool Get(T& value) {
+    if (size_ - offset_ < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(&value, data_ + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return true;
+  }
+
+  bool GetString(std::string& value) {
+    uint32_t length = 0;
+    if (!Get(length) || size_ - offset_ < length) {
+      return false;
+    }
+    value.assign(reinterpret_cast<const char*>(data_ + offset_), length);
+    offset_ += length;
+    return true;
+  }
+
+ private:
+  const std::byte* data_;
+  size_t size_;
+  size_t offset_ = 0;
+};
+
+// Fill in the checksum and length of a record whose payload is written.
+void Seal(std::vector<std::byte>& buffer) {
+  const auto payload_size =
+      static_cast<uint32_t>(buffer.size() - RECORD_HEADER_SIZE);
+  const uint32_t crc = Crc32(buffer.data() + RECORD_HEADER_SIZE, payload_size);
+  std::memcpy(buffer.data(), &crc, sizeof(crc));
+  std::memcpy(buffer.data() + sizeof(crc), &payload_size, sizeof(payload_size));
+}
+
+std::vector<std::byte> Encode(const MessageRecord& record) {
+  std::vector<std::byte> buffer(RECORD_HEADER_SIZE);
+  Put(buffer, RECORD_TYPE_MESSAGE);
+  Put(buffer, record.conversation_id);
+  Put(buffer, record.id);
+  Put(buffer, record.author_id);
+  Put(buffer, record.sent_timestamp);
+  PutString(buffer, record.author_name);
+  PutString(buffer, record.content);
+  Seal(buffer);
+  return buffer;
+}
+
+std::vector<std::byte> EncodeDeleted(const uint64_t message_id) {
+  std::vector<std::byte> buffer(RECORD_HEADER_SIZE);
+  Put(buffer, RECORD_TYPE_DELETED);
+  Put(buffer, message_id);
+  Seal(buffer);
+  return buffer;
+}
+
+// The ID of the deleted message, if this is a deletion record.
+std::optional<uint64_t> DecodeDeleted(const std::byte* payload,
+                                      const size_t size) {
+  Reader reader(payload, size);
+  uint8_t type = 0;
+  uint64_t message_id = 0;
+  if (!reader.Get(type) || type != RECORD_TYPE_DELETED ||
+      !reader.Get(message_id)) {
+    return std::nullopt;
+  }
+  return message_id;
+}
+
+std::optional<MessageRecord> Decode(const std::byte* payload,
+                                    const size_t size) {
+  Reader reader(payload, size);
+  uint8_t type = 0;
+  MessageRecord record;
+  if (!reader.Get(type) || type != RECORD_TYPE_MESSAGE ||
+      !reader.Get(record.conversation_id) || !reader.Get(record.id) ||
+      !reader.Get(record.author_id) || !reader.Get(record.sent_timestamp) ||
+      !reader.GetString(record.author_name) ||
+      !reader.GetString(record.content)) {
+    return std::nullopt;
+  }
+  return record;
+}
+
+std::vector<std::byte> SegmentHeader() {
+  std::vector<std::byte> header(SEGMENT_HEADER_SIZE);
+  std::memcpy(header.data(), SEGMENT_MAGIC.data(), SEGMENT_MAGIC.size());
+  std::memcpy(header.data() + SEGMENT_MAGIC.size(), &SEGMENT_VERSION,
+              sizeof(SEGMENT_VERSION));
+  return header;
+}
+
+std::optional<uint32_t> ParseSegmentNumber(const std::string& file_name) {
+  if (!file_name.starts_with(SEGMENT_PREFIX) ||
+      !file_name.ends_with(SEGMENT_SUFFIX)) {
+    return std::nullopt;
+  }
+  const auto* begin = file_name.data() + SEGMENT_PREFIX.size();
+  const auto* end = file_name.data() + file_name.size() - SEGMENT_SUFFIX.size();
+  uint32_t number = 0;
+  if (const auto [ptr, error] = std::from_chars(begin, end, number);
+      error != std::errc{} || ptr != end) {
+    return std::nullopt;
+  }
+  return number;
+}
+
+void SyncDirectory(const std::filesystem::path& directory) {
+  const int file_descriptor =
+      ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (file_descriptor >= 0) {
+    ::fsync(file_descriptor);
+    ::close(file_descriptor);
+  }
+}
+
+}  // namespace
+
+MessageCache::~MessageCache() { Close(); }
+
+MessageCache::MessageCache(MessageCache&& other) noexcept {
+  *this = std::move(other);
+}
+
+MessageCache& MessageCache::operator=(MessageCache&& other) noexcept {
+  if (this != &other) {
+    Close();
+    directory_ = std::move(other.directory_);
+    segments_ = std::exchange(other.segments_, {});
+    active_fd_ = std::exchange(other.active_fd_, -1);
+    conversations_ = std::exchange(other.conversations_, {});
+    messages_ = std::exchange(other.messages_, {});
+    newest_ = std::exchange(other.newest_, {});
+  }
+  return *this;
+}
+
+bool MessageCache::Open(const std::filesystem::path& directory) {
+  if (!OpenSegments(directory)) {
+    return false;
+  }
+  if (segments_.size() - 1 >= COMPACT_THRESHOLD) {
+    Compact();
+  }
+  return IsOpen();
+}
+
+bool MessageCache::OpenSegments(const std::filesystem::path& directory) {
+  Close();
+  directory_ = directory;
+
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  if (error) {
+    SPDLOG_ERROR("Could not create message cache directory {}: {}",
+                 directory_.string(), error.message());
+    return false;
+  }
+  // A leftover compaction output means we crashed before it was renamed into
+  // place, so the original segments are still intact.
+  std::filesystem::remove(directory_ / COMPACT_FILE_NAME, error);
+
+  for (const auto& entry :
+       std::filesystem::directory_iterator(directory_, error)) {
+    if (const auto number =
+            ParseSegmentNumber(entry.path().filename().string())) {
+      segments_.push_back({.number = *number, .path = entry.path()});
+    }
+  }
+  std::ranges::sort(segments_, {}, &Segment::number);
+
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    if (!ScanSegment(i)) {
+      Close();
+      return false;
+    }
+  }
+
+  // Keep appending to the newest segment while it has room.
+  if (segments_.empty() || segments_.back().size < SEGMENT_HEADER_SIZE ||
+      segments_.back().size >= MAX_SEGMENT_SIZE) {
+    const uint32_t next = segments_.empty() ? 1 : segments_.back().number + 1;
+    if (!StartSegment(next)) {
+      Close();
+      return false;
+    }
+  } else {
+    active_fd_ = ::open(segments_.back().path.c_str(),
+                        O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (active_fd_ < 0) {
+      SPDLOG_ERROR("Could not open message cache segment {}: {}",
+                   segments_.back().path.string(), std::strerror(errno));
+      Close();
+      return false;
+    }
+  }
+
+  SPDLOG_INFO("Opened message cache {} with {} messages in {} segments",
+              directory_.string(), messages_.size(), segments_.size());
+  return true;
+}
+
+void MessageCache::Close() {
+  if (active_fd_ >= 0) {
+    ::fdatasync(active_fd_);
+    ::close(active_fd_);
+    active_fd_ = -1;
+  }
+  for (auto& segment : segments_) {
+    Unmap(segment);
+  }
+  segments_.clear();
+  conversations_.clear();
+  messages_.clear();
+  newest_.clear();
+}
+
+bool MessageCache::Contains(const uint64_t message_id) const {
+  return messages_.contains(message_id);
+}
+
+void MessageCache::Append(const MessageRecord& record) {
+  if (!IsOpen() || Contains(record.id)) {
+    return;
+  }
+  Write(Encode(record), &record);
+}
+
+void MessageCache::Update(const MessageRecord& record) {
+  // The newer copy wins when the log is scanned.
+  if (!IsOpen() || !Contains(record.id)) {
+    return;
+  }
+  Write(Encode(record), &record);
+}
+
+void MessageCache::Remove(const uint64_t message_id) {
+  if (!IsOpen() || !Contains(message_id)) {
+    return;
+  }
+  Write(EncodeDeleted(message_id), nullptr);
+  if (IsOpen()) {
+    messages_.erase(message_id);
+  }
+}
+
+void MessageCache::Write(const std::vector<std::byte>& encoded,
+                         const MessageRecord* record) {
+  if (segments_.back().size + encoded.size() > MAX_SEGMENT_SIZE) {
+    ::fdatasync(active_fd_);
+    ::close(active_fd_);
+    active_fd_ = -1;
+    if (!StartSegment(segments_.back().number + 1)) {
+      Close();
+      return;
+    }
+  }
+
+  const Location location{
+      .segment = static_cast<uint32_t>(segments_.size() - 1),
+      .offset = segments_.back().size};
+  if (!WriteAll(active_fd_, encoded)) {
+    // Whatever made it to disk is a torn record that the next Open() will
+    // truncate, so stop using the cache for this session.
+    Close();
+    return;
+  }
+  segments_.back().size += encoded.size();
+  if (record != nullptr) {
+    Index(*record, location);
+  }
+}
+
+uint64_t MessageCache::NewestMessageId(const uint64_t conversation_id) const {
+  const auto newest = newest_.find(conversation_id);
+  return newest == newest_.end() ? 0 : newest->second;
+}
+
+std::vector<MessageRecord> MessageCache::Load(const uint64_t conversation_id) {
+  std::vector<MessageRecord> records;
+  const auto conversation = conversations_.find(conversation_id);
+  if (conversation == conversations_.end()) {
+    return records;
+  }
+
+  records.reserve(conversation->second.size());
+  for (const auto& location : conversation->second) {
+    auto record = ReadAt(location);
+    // Skip records that have been superseded by a later copy, or deleted.
+    if (const auto current = record ? messages_.find(record->id)
+                                    : messages_.end();
+        current != messages_.end() && current->second == location) {
+      records.push_back(std::move(*record));
+    }
+  }
+  std::ranges::sort(records, {}, &MessageRecord::id);
+  return records;
+}
+
+std::optional<MessageRecord> MessageCache::Get(const uint64_t message_id) {
+  const auto location = messages_.find(message_id);
+  if (location == messages_.end()) {
+    return std::nullopt;
+  }
+  return ReadAt(location->second);
+}
+
+void MessageCache::ForEach(
+    const std::function<bool(uint64_t message_id)>& filter,
+    const std::function<void(const MessageRecord&)>& visitor) {
+  for (const auto& [message_id, location] : messages_) {
+    if (filter(message_id)) {
+      if (const auto record = ReadAt(location)) {
+        visitor(*record);
+      }
+    }
+  }
+}
+
+bool MessageCache::Compact() {
+  if (!IsOpen() || segments_.size() < 3) {
+    return false;
+  }
+
+  // Everything but the active segment gets rewritten.
+  const auto sealed = static_cast<uint32_t>(segments_.size() - 1);
+  std::vector<MessageRecord> live;
+  // Messages deleted while their records are still in the sealed segments.
+  // Until those are all removed, their tombstones have to be kept.
+  std::unordered_set<uint64_t> deleted;
+  for (const auto& [conversation_id, locations] : conversations_) {
+    for (const auto& location : locations) {
+      if (location.segment >= sealed) {
+        continue;
+      }
+      auto record = ReadAt(location);
+      if (!record) {
+        continue;
+      }
+      const auto current = messages_.find(record->id);
+      if (current == messages_.end()) {
+        deleted.insert(record->id);
+      } else if (current->second == location) {
+        live.push_back(std::move(*record));
+      }
+    }
+  }
+  // Group conversations together so loading one touches as few pages as
+  // possible.
+  std::ranges::sort(live, [](const auto& lhs, const auto& rhs) {
+    return std::tie(lhs.conversation_id, lhs.id) <
+           std::tie(rhs.conversation_id, rhs.id);
+  });
+
+  const auto compact_path = directory_ / COMPACT_FILE_NAME;
+  const int file_descriptor =
+      ::open(compact_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+             0600);
+  if (file_descriptor < 0) {
+    SPDLOG_ERROR("Could not create message cache compaction file: {}",
+                 std::strerror(errno));
+    return false;
+  }
+  bool written = WriteAll(file_descriptor, SegmentHeader());
+  for (const auto message_id : deleted) {
+    written = written && WriteAll(file_descriptor, EncodeDeleted(message_id));
+  }
+  for (const auto& record : live) {
+    written = written && WriteAll(file_descriptor, Encode(record));
+  }
+  if (!written || ::fdatasync(file_descriptor) != 0) {
+    ::close(file_descriptor);
+    std::error_code error;
+    std::filesystem::remove(compact_path, error);
+    SPDLOG_ERROR("Could not write compacted message cache segment");
+    return false;
+  }
+  ::close(file_descriptor);
+
+  // The compacted segment replaces the newest sealed segment, so if we crash
+  // before the older ones are removed, its copies still win on the next scan,
+  // and its tombstones keep deleted messages from coming back. Once the
+  // older segments are gone, the next compaction drops the tombstones.
+  std::vector<std::filesystem::path> replaced;
+  for (uint32_t i = 0; i < sealed; ++i) {
+    replaced.push_back(segments_[i].path);
+  }
+  Close();
+
+  std::error_code error;
+  std::filesystem::rename(compact_path, replaced.back(), error);
+  const bool compacted = !error;
+  if (!compacted) {
+    SPDLOG_ERROR("Could not install compacted message cache segment: {}",
+                 error.message());
+    std::filesystem::remove(compact_path, error);
+  } else {
+    SyncDirectory(directory_);
+    replaced.pop_back();
+    for (const auto& path : replaced) {
+      std::filesystem::remove(path, error);
+    }
+    SyncDirectory(directory_);
+    SPDLOG_INFO("Compacted {} message cache segments into one ({} messages)",
+                sealed, live.size());
+  }
+
+  // Reopening must not compact again, or a failure here would repeat
+  // forever.
+  OpenSegments(directory_);
+  return compacted;
+}
+
+bool MessageCache::ScanSegment(const size_t segment_index) {
+  auto& segment = segments_[segment_index];
+  std::error_code error;
+  segment.size = std::filesystem::file_size(segment.path, error);
+  if (error) {
+    SPDLOG_ERROR("Could not read message cache segment {}: {}",
+                 segment.path.string(), error.message());
+    return false;
+  }
+
+  const auto* data = Map(segment, segment.size);
+  if (segment.size < SEGMENT_HEADER_SIZE || data == nullptr ||
+      std::memcmp(data, SEGMENT_MAGIC.data(), SEGMENT_MAGIC.size()) != 0) {
+    SPDLOG_WARN("Ignoring unrecognised message cache segment {}",
+                segment.path.string());
+    segment.size = 0;
+    return true;
+  }
+
+  size_t offset = SEGMENT_HEADER_SIZE;
+  while (segment.size - offset >= RECORD_HEADER_SIZE) {
+    uint32_t crc = 0;
+    uint32_t length = 0;
+    std::memcpy(&crc, data + offset, sizeof(crc));
+    std::memcpy(&length, data + offset + sizeof(crc), sizeof(length));
+    const auto* payload = data + offset + RECORD_HEADER_SIZE;
+    if (segment.size - offset - RECORD_HEADER_SIZE < length ||
+        Crc32(payload, length) != crc) {
+      break;
+    }
+    if (const auto record = Decode(payload, length)) {
+      Index(*record, {.segment = static_cast<uint32_t>(segment_index),
+                      .offset = offset});
+    } else if (const auto deleted = DecodeDeleted(payload, length)) {
+      messages_.erase(*deleted);
+    }
+    offset += RECORD_HEADER_SIZE + length;
+  }
+
+  if (offset != segment.size) {
+    SPDLOG_WARN("Truncating {} bytes of incomplete records from {}",
+                segment.size - offset, segment.path.string());
+    Unmap(segment);
+    std::filesystem::resize_file(segment.path, offset, error);
+    segment.size = offset;
+  }
+  return true;
+}
+
+bool MessageCache::StartSegment(const uint32_t number) {
+  Segment segment{.number = number, .path = SegmentPath(number)};
+  active_fd_ =
+      ::open(segment.path.c_str(),
+             O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+  if (active_fd_ < 0) {
+    SPDLOG_ERROR("Could not create message cache segment {}: {}",
+                 segment.path.string(), std::strerror(errno));
+    return false;
+  }
+  const auto header = SegmentHeader();
+  if (!WriteAll(active_fd_, header)) {
+    ::close(active_fd_);
+    active_fd_ = -1;
+    return false;
+  }
+  segment.size = header.size();
+  segments_.push_back(std::move(segment));
+  SyncDirectory(directory_);
+  return true;
+}
+
+bool MessageCache::WriteAll(const int file_descriptor,
+                            const std::vector<std::byte>& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    const auto result = ::write(file_descriptor, data.data() + written,
+                                data.size() - written);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      SPDLOG_ERROR("Failed writing to message cache: {}", std::strerror(errno));
+      return false;
+    }
+    written += static_cast<size_t>(result);
+  }
+  return true;
+}
+
+const std::byte* MessageCache::Map(Segment& segment,
+                                   const size_t minimum_size) {
+  if (segment.map != nullptr && segment.mapped_size >= minimum_size) {
+    return segment.map;
+  }
+  // The active segment grows as we append, so remap it to cover the new data.
+  Unmap(segment);
+  if (segment.size == 0 || segment.size < minimum_size) {
+    return nullptr;
+  }
+
+  const int file_descriptor =
+      ::open(segment.path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (file_descriptor < 0) {
+    return nullptr;
+  }
+  void* map =
+      ::mmap(nullptr, segment.size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+  ::close(file_descriptor);
+  if (map == MAP_FAILED) {
+    SPDLOG_ERROR("Could not map message cache segment {}: {}",
+                 segment.path.string(), std::strerror(errno));
+    return nullptr;
+  }
+  segment.map = static_cast<const std::byte*>(map);
+  segment.mapped_size = segment.size;
+  return segment.map;
+}
+
+void MessageCache::Unmap(Segment& segment) {
+  if (segment.map != nullptr) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    ::munmap(const_cast<std::byte*>(segment.map), segment.mapped_size);
+    segment.map = nullptr;
+    segment.mapped_size = 0;
+  }
+}
+
+std::optional<MessageRecord> MessageCache::ReadAt(const Location& location) {
+  auto& segment = segments_[location.segment];
+  const auto* data = Map(segment, location.offset + RECORD_HEADER_SIZE);
+  if (data == nullptr) {
+    return std::nullopt;
+  }
+  uint32_t length = 0;
+  std::memcpy(&length, data + location.offset + sizeof(uint32_t),
+              sizeof(length));
+  data = Map(segment, location.offset + RECORD_HEADER_SIZE + length);
+  if (data == nullptr) {
+    return std::nullopt;
+  }
+  return Decode(data + location.offset + RECORD_HEADER_SIZE, length);
+}
+
+void MessageCache::Index(const MessageRecord& record,
+                         const Location& location) {
+  conversations_[record.conversation_id].push_back(location);
+  messages_[record.id] = location;
+  auto& newest = newest_[record.conversation_id];
+  newest = std::max(newest, record.id);
+}
+
+std::filesystem::path MessageCache::SegmentPath(const uint32_t number) const {
+  constexpr int NUMBER_WIDTH = 6;
+  auto digits = std::to_string(number);
+  if (digits.size() < NUMBER_WIDTH) {
+    digits.insert(0, NUMBER_WIDTH - digits.size(), '0');
+  }
+  return directory_ /
+         (std::string(SEGMENT_PREFIX) + digits + std::string(SEGMENT_SUFFIX));
+}
+
+}  // namespace discord_social_tui
@@ -17,13 +17,136 @@
 #include <spdlog/spdlog.h>
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <utility>
+
+#include "app/logging.hpp"
+#include "app/rich_text.hpp"
+#include "app/sanitize.hpp"
+#include "app/text_layout.hpp"
 #include "ftxui/component/component.hpp"
 #include "ftxui/dom/elements.hpp"
+#include "ftxui/screen/string.hpp"
 
 namespace discord_social_tui {
 
-Messages::Messages(const std::shared_ptr<discordpp::Client>& client)
-    : client_(client) {
+namespace {
+
+// Messages log at their own level, e.g. SPDLOG_LEVEL=info,messages=debug
+spdlog::logger* Log() {
+  static const auto logger = Logger("messages");
+  return logger.get();
+}
+
+// Per call site, for those logging each message as it changes
+constexpr uint32_t MESSAGE_LOGS_PER_SECOND = 10;
+
+// Make a message safe to draw and parse its markup, once, as it comes in.
+void PrepareForDisplay(MessageRecord& record) {
+  if (record.sanitized) {
+    return;
+  }
+  Sanitize(record);
+  record.spans = ParseRichText(record.content);
+}
+
+// Draw a run of message text in its style.
+ftxui::Element RenderRun(const StyledRun& run) {
+  auto element = ftxui::text(run.text);
+  const auto has = [&run](const uint16_t style) {
+    return (run.style & style) != 0;
+  };
+  if (has(STYLE_BOLD)) {
+    element |= ftxui::bold;
+  }
+  if (has(STYLE_ITALIC)) {
+    element |= ftxui::italic;
+  }
+  if (has(STYLE_UNDERLINE) || has(STYLE_LINK)) {
+    element |= ftxui::underlined;
+  }
+  if (has(STYLE_STRIKETHROUGH)) {
+    element |= ftxui::strikethrough;
+  }
+  if (has(STYLE_CODE)) {
+    element |= ftxui::bgcolor(ftxui::Color::GrayDark);
+  }
+  if (has(STYLE_LINK)) {
+    element |= ftxui::color(ftxui::Color::Blue);
+  }
+  if (has(STYLE_MENTION)) {
+    element |= ftxui::color(ftxui::Color::Magenta);
+  }
+  if (has(STYLE_EMOJI)) {
+    element |= ftxui::color(ftxui::Color::Yellow);
+  }
+  if (has(STYLE_SPOILER)) {
+    // Unreadable, but still taking up its space
+    element |= ftxui::color(ftxui::Color::GrayDark) |
+               ftxui::bgcolor(ftxui::Color::GrayDark);
+  }
+  return element;
+}
+
+ftxui::Element RenderLine(const StyledLine& line) {
+  ftxui::Elements runs;
+  runs.reserve(line.size());
+  for (const auto& run : line) {
+    runs.push_back(RenderRun(run));
+  }
+  return ftxui::hbox(std::move(runs));
+}
+
+// Copy what we need out of the SDK's handle, so it can be cached on disk.
+// This is where messages come in, so it's where they're sanitized.
+MessageRecord ToRecord(const discordpp::MessageHandle& message,
+                       const uint64_t conversation_id) {
+  MessageRecord record{
+      .id = message.Id(),
+      .conversation_id = conversation_id,
+      .author_id = message.AuthorId(),
+      .sent_timestamp = message.SentTimestamp(),
+      .author_name = message.Author()
+                         .and_then([](const discordpp::UserHandle& author)
+                                       -> std::optional<std::string> {
+                           return author.DisplayName();
+                         })
+                         .value_or("<unknown>"),
+      .content = message.Content(),
+  };
+  PrepareForDisplay(record);
+  return record;
+}
+
+}  // namespace
+
+Messages::Messages(const std::shared_ptr<discordpp::Client>& client,
+                   std::shared_ptr<MessageCache> cache,
+                   std::shared_ptr<SearchIndex> search_index,
+                   std::shared_ptr<Names> names)
+    : client_(client),
+      cache_(std::move(cache)),
+      search_index_(std::move(search_index)),
+      names_(std::move(names)),
+      history_sync_(std::make_unique<HistorySync>(
+          client, cache_,
+          [this](const uint64_t user_id,
+                 const std::vector<discordpp::MessageHandle>& messages,
+                 const bool contiguous) {
+            MergeHistory(user_id, messages, contiguous);
+          })),
+      outbound_(std::make_unique<OutboundQueue>(
+          client, [this](const uint64_t /*recipient_id*/,
+                         const uint64_t message_id) {
+            // Swap the pending echo for the real thing, without waiting for
+            // the message created callback.
+            ReceiveMessage(message_id);
+          })) {
+  message_source_ = [this](const uint64_t message_id) {
+    return LookUpMessage(message_id);
+  };
   // Initialize UI components
   auto option = ftxui::InputOption();
   option.multiline = false;
@@ -45,7 +168,10 @@ Messages::Messages(const std::shared_ptr<discordpp::Client>& client)
     return state.element;
   };
   /// If you write anything in the input textfield, the unread thing goes away.
-  option.on_change = [this]() { ResetSelectedUnreadMessages(); };
+  option.on_change = [this]() {
+    last_keystroke_ = std::chrono::steady_clock::now();
+    ResetSelectedUnreadMessages();
+  };
   option.on_enter = [this]() { SendMessage(); };
 
   input_component_ = ftxui::Input(&input_text_, "Type a message...", option);
@@ -58,7 +184,120 @@ void Messages::SetFriends(const std::shared_ptr<Friends>& friends) {
 
 void Messages::Run() {
   client_->SetMessageCreatedCallback(
-      [this](const uint64_t message_id) { AddUserMessage(message_id); });
+      [this](const uint64_t message_id) { ReceiveMessage(message_id); });
+  client_->SetMessageUpdatedCallback(
+      [this](const uint64_t message_id) { UpdateUserMessage(message_id); });
+  client_->SetMessageDeletedCallback(
+      [this](const uint64_t message_id, const uint64_t /*channel_id*/) {
+        DeleteUserMessage(message_id);
+      });
+}
+
+void Messages::SyncHistory() { history_sync_->SyncAll(); }
+
+void Messages::HistoryOpened() { history_open_ = true; }
+
+void Messages::SetConnected(const bool connected) {
+  outbound_->SetConnected(connected);
+}
+
+void Messages::Tick() {
+  IngestMessages();
+  outbound_->Tick();
+  CompressIdleConversations();
+}
+
+void Messages::SetCompressAfter(const std::chrono::seconds idle) {
+  compress_after_ = idle;
+}
+
+void Messages::CompressIdleConversations() {
+  const auto now = std::chrono::steady_clock::now();
+  if (compress_after_.count() <= 0 ||
+      now - last_compress_ < COMPRESS_INTERVAL) {
+    return;
+  }
+  last_compress_ = now;
+
+  size_t compressed = 0;
+  size_t saved = 0;
+  for (auto& [user_id, conversation] : user_messages_) {
+    // History still to be merged would only decompress it again, and
+    // unsynced conversations can hold messages the cache doesn't.
+    if (user_id == opened_conversation_ || !history_sync_->IsSynced(user_id) ||
+        IsLoading(user_id) ||
+        now - last_viewed_[user_id] < compress_after_) {
+      continue;
+    }
+    if (conversation.Compress()) {
+      ++compressed;
+      saved += conversation.MemorySaved();
+    }
+  }
+  if (compressed > 0) {
+    SPDLOG_LOGGER_INFO(
+        Log(), "Compressed {} idle conversations in {}, saving {} KiB",
+        compressed, FormatDuration(std::chrono::steady_clock::now() - now),
+        saved / 1024);
+  }
+}
+
+void Messages::FocusMessage(const uint64_t message_id) {
+  focused_message_id_ = message_id;
+}
+
+void Messages::Prefetch(const uint64_t user_id) {
+  Load(user_id, HistorySync::Priority::Background);
+}
+
+bool Messages::IsLoaded(const uint64_t user_id) const {
+  return user_messages_.contains(user_id) && !IsLoading(user_id);
+}
+
+bool Messages::IsLoading(const uint64_t user_id) const {
+  return history_sync_->IsPending(user_id);
+}
+
+bool Messages::IsTyping() const {
+  return std::chrono::steady_clock::now() - last_keystroke_ < TYPING_TIMEOUT;
+}
+
+std::vector<uint64_t> Messages::UnreadConversations() const {
+  return unread_.Conversations();
+}
+
+double Messages::OpenHitRate() const {
+  return opens_ == 0 ? 0.0
+                     : static_cast<double>(warm_opens_) /
+                           static_cast<double>(opens_);
+}
+
+void Messages::LogStats() const {
+  constexpr double PERCENT = 100.0;
+  SPDLOG_LOGGER_INFO(
+      Log(), "{} of {} conversations were already loaded when opened ({:.1f}%)",
+      warm_opens_, opens_, OpenHitRate() * PERCENT);
+
+  const auto seconds = std::chrono::duration<double>(ingest_time_).count();
+  SPDLOG_LOGGER_INFO(
+      Log(), "Ingested {} messages in {} ({:.0f} messages/sec)",
+      ingested_messages_, FormatDuration(ingest_time_),
+      seconds > 0 ? static_cast<double>(ingested_messages_) / seconds : 0.0);
+
+  size_t compressed = 0;
+  size_t saved = 0;
+  for (const auto& [user_id, conversation] : user_messages_) {
+    if (conversation.IsCompressed()) {
+      ++compressed;
+      saved += conversation.MemorySaved();
+    }
+  }
+  SPDLOG_LOGGER_INFO(
+      Log(),
+      "{} of {} conversations compressed, saving {} KiB. Decompressed on "
+      "reopen: {}",
+      compressed, user_messages_.size(), saved / 1024,
+      decompress_latency_.Summary());
 }
 
 ftxui::Component Messages::Render() {
@@ -67,9 +306,19 @@ ftxui::Component Messages::Render() {
     if (const auto selected_friend = friends_->GetSelectedFriend();
         selected_friend.has_value()) {
       const auto& friend_ = selected_friend.value();
+      auto sync_status = history_sync_->LastLatency(friend_->GetId())
+                             .transform([](const auto latency) {
+                               return ftxui::text("synced in " +
+                                                  FormatDuration(latency)) |
+                                      ftxui::dim;
+                             })
+                             .value_or(ftxui::text(""));
       return ftxui::vbox(
-          {ftxui::text("Messages with " + friend_->GetDisplayName()) |
-               ftxui::bold,
+          {ftxui::hbox(
+               {ftxui::text(std::string("Messages with ")
+                                .append(friend_->GetDisplayName())) |
+                    ftxui::bold,
+                ftxui::filler(), sync_status}),
            ftxui::separator()});
     }
     return ftxui::vbox(
@@ -80,30 +329,53 @@ ftxui::Component Messages::Render() {
   // Create scrollable messages area (only the message list scrolls)
   const auto messages_display = ftxui::Renderer([this] {
     ftxui::Elements message_elements;
+    // Rows show authors' current names, so rebuild them after a rename.
+    if (names_->Generation() != names_generation_) {
+      names_generation_ = names_->Generation();
+      rendered_rows_.clear();
+    }
 
     // Get currently selected friend
     if (const auto selected_friend = friends_->GetSelectedFriend()) {
+      const auto user_id = selected_friend.value()->GetId();
+      if (user_id != opened_conversation_) {
+        RecordOpen(user_id);
+      }
       // Get and display all messages from this friend
-      if (const auto& messages =
-              this->GetMessages(selected_friend.value()->GetId());
-          messages.empty()) {
+      const auto& messages = this->GetMessages(user_id);
+      const auto& pending = outbound_->GetPending(user_id);
+      if (messages.empty() && pending.empty()) {
         message_elements.push_back(ftxui::text("No messages yet...") |
                                    ftxui::dim);
-      } else {
-        for (const auto& message : messages) {
-          // Display author and message content
-          auto author_name =
-              message.Author()
-                  .and_then([](const discordpp::UserHandle& author)
-                                -> std::optional<std::string> {
-                    return author.DisplayName();
-                  })
-                  .value_or("<unknown>");
+      }
+      for (const auto& message : messages) {
+        auto row = RenderRow(message);
+        // Scroll to and highlight a message jumped to from search
+        if (message.id == focused_message_id_) {
+          row = row | ftxui::inverted | ftxui::focus;
+        }
+        message_elements.push_back(row);
+      }
 
+      // Messages we've sent that the server hasn't accepted yet
+      if (!pending.empty()) {
+        const auto author = client_->GetCurrentUserV2()
+                                .transform([](const auto& user) {
+                                  return user.DisplayName();
+                                })
+                                .value_or("<unknown>");
+        for (const auto& message : pending) {
+          auto state = ftxui::text(" (" + DescribeState(message) + ")");
+          if (message.state == OutboundQueue::State::Failed) {
+            state = ftxui::text(" (" + DescribeState(message) +
+                                ", ctrl+r to retry, ctrl+d to discard)") |
+                    ftxui::color(ftxui::Color::Red);
+          }
           message_elements.push_back(
-              ftxui::hbox({ftxui::text(author_name + ": ") |
+              ftxui::hbox({ftxui::text(author + ": ") |
                                ftxui::color(ftxui::Color::Cyan),
-                           ftxui::text(message.Content())}));
+                           ftxui::text(message.content), state}) |
+              ftxui::dim);
         }
       }
     }
@@ -129,138 +401,432 @@ ftxui::Component Messages::Render() {
       input_with_separator  // Input area stays at bottom
   });
 
-  return messages_container_;
+  // A message that failed to send holds up everything after it, until the
+  // user decides what to do with it.
+  return messages_container_ |
+         ftxui::CatchEvent([this](const ftxui::Event& event) {
+           if (event != ftxui::Event::CtrlR && event != ftxui::Event::CtrlD) {
+             return false;
+           }
+           const auto selected_friend = friends_->GetSelectedFriend();
+           if (!selected_friend ||
+               !outbound_->HasFailed(selected_friend.value()->GetId())) {
+             return false;
+           }
+           const auto user_id = selected_friend.value()->GetId();
+           if (event == ftxui::Event::CtrlR) {
+             outbound_->Retry(user_id);
+           } else {
+             outbound_->Discard(user_id);
+           }
+           return true;
+         });
 }
 
 void Messages::SendMessage() {
-  SPDLOG_INFO("Sending message: {}", input_text_);
+  SPDLOG_LOGGER_DEBUG(Log(), "Sending message of {} bytes", input_text_.size());
   friends_->GetSelectedFriend().and_then(
       [this](const std::shared_ptr<Friend>& friend_)
           -> std::optional<std::monostate> {
         if (input_text_.empty()) {
-          SPDLOG_DEBUG("Cannot send empty message");
+          SPDLOG_LOGGER_DEBUG(Log(), "Cannot send empty message");
           return std::nullopt;
         }
 
-        client_->SendUserMessage(
-            friend_->GetId(), input_text_,
-            [this, friend_](const discordpp::ClientResult& result,
-                            unsigned long message_id) {
-              if (!result.Successful()) {
-                SPDLOG_ERROR("Failed to send message: {}", result.Error());
-                return;
-              }
-              input_text_.clear();
-              SPDLOG_INFO("Message sent: {}", message_id);
-            });
+        // Take the text now, so the next message can be typed straight away.
+        outbound_->Send(friend_->GetId(), std::exchange(input_text_, {}));
         return std::monostate{};
       });
 }
 
-void Messages::AddUserMessage(const uint64_t message_id) {
+void Messages::ReceiveMessage(const uint64_t message_id) {
+  // Bursts arrive in a single RunCallbacks(), so they're handled together
+  // on the next tick.
+  incoming_.push_back(message_id);
+}
+
+std::optional<MessageRecord> Messages::LookUpMessage(
+    const uint64_t message_id) const {
+  const auto message = client_->GetMessageHandle(message_id);
+  if (!message) {
+    return std::nullopt;
+  }
+  const auto conversation_id = ConversationId(*message);
+  if (!conversation_id) {
+    return std::nullopt;
+  }
+  // Busy conversations would flood the log, and the content stays out of it
+  // regardless.
+  LOG_PER_SECOND(Log(), spdlog::level::debug, MESSAGE_LOGS_PER_SECOND,
+                 "New message received: {} from {} ({} bytes)", message_id,
+                 message->AuthorId(), message->Content().size());
+  return ToRecord(*message, *conversation_id);
+}
+
+void Messages::IngestMessages() {
+  if (incoming_.empty()) {
+    return;
+  }
+
+  const auto started = std::chrono::steady_clock::now();
+  std::vector<MessageRecord> records;
+  records.reserve(incoming_.size());
+  for (const auto message_id : std::exchange(incoming_, {})) {
+    if (auto record = message_source_(message_id)) {
+      // A test source may hand back a raw record.
+      PrepareForDisplay(*record);
+      records.push_back(std::move(*record));
+    }
+  }
+
+  const auto selected_id =
+      friends_->GetSelectedFriend()
+          .transform([](const std::shared_ptr<Friend>& friend_) {
+            return friend_->GetId();
+          })
+          .value_or(0);
+
+  // Group the messages by conversation
+  const auto message_count = records.size();
+  std::unordered_map<uint64_t, std::vector<MessageRecord>> batches;
+  for (auto& record : records) {
+    batches[record.conversation_id].push_back(std::move(record));
+  }
+
+  std::vector<uint64_t> unread_changed;
+  for (auto& [user_id, records] : batches) {
+    bool unread = false;
+    for (const auto& record : records) {
+      // The cache must never get ahead of the synced history.
+      if (history_sync_->Observe(user_id, record.id)) {
+        cache_->Append(record);
+      }
+      search_index_->Add(record);
+      // My own messages are never unread, and neither is the conversation
+      // being looked at.
+      // TODO: also check if the messages component is being displayed.
+      if (record.author_id == user_id && user_id != selected_id) {
+        unread = unread_.Add(user_id, record.id) || unread;
+      }
+    }
+    if (unread) {
+      unread_changed.push_back(user_id);
+    }
+
+    // Conversations that haven't been loaded will pick these up when they
+    // are. Our own messages arrive twice, once from sending them.
+    if (const auto conversation = user_messages_.find(user_id);
+        conversation != user_messages_.end()) {
+      conversation->second.Merge(std::move(records));
+    }
+    TouchConversation(user_id);
+  }
+
+  const auto elapsed = std::chrono::steady_clock::now() - started;
+  ingested_messages_ += message_count;
+  ingest_time_ += elapsed;
+  LOG_PER_SECOND(Log(), spdlog::level::info, 1,
+                 "Received {} messages across {} conversations in {}",
+                 message_count, batches.size(), FormatDuration(elapsed));
+
+  if (!unread_changed.empty()) {
+    OnUnreadChange(unread_changed);
+  }
+}
+
+void Messages::UpdateUserMessage(const uint64_t message_id) {
   client_->GetMessageHandle(message_id)
       .and_then([this](const discordpp::MessageHandle& message)
                     -> std::optional<std::monostate> {
-        SPDLOG_INFO("New message received: {} - {}", message.AuthorId(),
-                    message.Content());
-        const auto current_user = client_->GetCurrentUserV2();
-
-        if (!current_user) {
-          SPDLOG_ERROR("Current user not available");
+        const auto conversation_id = ConversationId(message);
+        if (!conversation_id) {
           return std::nullopt;
         }
-
-        uint64_t user_id = 0;
-        // store my own messages against the recipient
-        if (message.AuthorId() == current_user->Id()) {
-          user_id = message.RecipientId();
-        } else {
-          user_id = message.AuthorId();
-
-          // if nothing selected, or not on the same user, then set it to not
-          // being read.
-          friends_->GetSelectedFriend()
-              .and_then([this, user_id](const std::shared_ptr<Friend>& friend_)
-                            -> std::optional<std::monostate> {
-                // TODO: also check if the messages component is being
-                // displayed, if not it doesn't matter if the selected user is
-                // the same.
-                if (friend_->GetId() != user_id) {
-                  unread_messages_[user_id] = true;
-                }
-                return std::monostate{};
-              })
-              .or_else([this, user_id] -> std::optional<std::monostate> {
-                unread_messages_[user_id] = true;
-                return std::monostate{};
-              });
+        LOG_PER_SECOND(Log(), spdlog::level::debug, MESSAGE_LOGS_PER_SECOND,
+                       "Message edited: {} ({} bytes)", message.Id(),
+                       message.Content().size());
+
+        auto record = ToRecord(message, *conversation_id);
+        const auto conversation = user_messages_.find(*conversation_id);
+        // The search index needs the old text to take it out.
+        std::optional<MessageRecord> previous;
+        if (conversation != user_messages_.end()) {
+          if (const auto* found = conversation->second.Find(record.id)) {
+            previous = *found;
+          }
         }
-
-        if (!user_messages_.contains(user_id)) {
-          user_messages_[user_id] = std::vector<discordpp::MessageHandle>();
+        if (!previous) {
+          previous = cache_->Get(record.id);
+        }
+        if (previous) {
+          search_index_->Remove(*previous);
+          search_index_->Add(record);
         }
-        user_messages_[user_id].push_back(message);
-        OnUnreadChange();
+        cache_->Update(record);
 
+        if (conversation != user_messages_.end() &&
+            conversation->second.Update(std::move(record))) {
+          rendered_rows_.erase(message.Id());
+        }
         return std::monostate{};
       });
 }
 
+void Messages::DeleteUserMessage(const uint64_t message_id) {
+  LOG_PER_SECOND(Log(), spdlog::level::debug, MESSAGE_LOGS_PER_SECOND,
+                 "Message deleted: {}", message_id);
+  // We're only told the channel, so look the message up to find its
+  // conversation, falling back to checking each loaded one.
+  auto previous = cache_->Get(message_id);
+  auto conversation = previous ? user_messages_.find(previous->conversation_id)
+                               : user_messages_.end();
+  if (conversation == user_messages_.end()) {
+    conversation = std::ranges::find_if(
+        user_messages_, [message_id](auto& entry) {
+          // Only synced conversations are compressed, and everything in
+          // those is in the cache, so they needn't be checked.
+          return entry.second.Contains(message_id);
+        });
+  }
+
+  if (conversation != user_messages_.end()) {
+    // A compressed conversation finds nothing, but then the cache already
+    // had the message, and erasing decompresses it.
+    if (const auto* found = conversation->second.Find(message_id)) {
+      previous = *found;
+    }
+    if (conversation->second.Erase(message_id)) {
+      rendered_rows_.erase(message_id);
+    }
+  }
+  if (previous) {
+    search_index_->Remove(*previous);
+    // Only the friend's messages were counted as unread.
+    if (const auto user_id = previous->conversation_id;
+        previous->author_id == user_id && unread_.Remove(user_id, message_id)) {
+      OnUnreadChange({&user_id, 1});
+    }
+  }
+  cache_->Remove(message_id);
+}
+
 void Messages::ResetSelectedUnreadMessages() {
   friends_->GetSelectedFriend().and_then(
       [this](const std::shared_ptr<Friend>& friend_)
           -> std::optional<std::monostate> {
-        unread_messages_[friend_->GetId()] = false;
-        OnUnreadChange();
+        if (const auto user_id = friend_->GetId(); unread_.MarkRead(user_id)) {
+          OnUnreadChange({&user_id, 1});
+        }
         return std::monostate{};
       });
 }
 
-std::vector<discordpp::MessageHandle> Messages::GetMessages(
+void Messages::RestoreUnread(const uint64_t user_id, const uint32_t count) {
+  if (unread_.Restore(user_id, count)) {
+    OnUnreadChange({&user_id, 1});
+  }
+}
+
+const Conversation& Messages::GetMessages(
     const uint64_t user_id) {
-  if (!user_messages_.contains(user_id)) {
-    // Initialise empty vector to indicate we're fetching
-    user_messages_[user_id] = std::vector<discordpp::MessageHandle>();
-
-    // Fetch message history from Discord API
-    constexpr int32_t message_limit = 50;
-    client_->GetUserMessagesWithLimit(
-        user_id, message_limit,
-        [this, user_id](const discordpp::ClientResult& result,
-                        std::vector<discordpp::MessageHandle> messages) {
-          if (!result.Successful()) {
-            SPDLOG_ERROR("Failed to fetch message history for user {}: {}",
-                         user_id, result.Error());
-            return;
-          }
+  if (!history_open_) {
+    static const Conversation EMPTY;
+    return EMPTY;
+  }
+  Load(user_id, HistorySync::Priority::Foreground);
+  last_viewed_[user_id] = std::chrono::steady_clock::now();
+  auto& conversation = user_messages_[user_id];
+  if (conversation.IsCompressed()) {
+    const auto saved = conversation.MemorySaved();
+    const auto started = std::chrono::steady_clock::now();
+    const bool decompressed = conversation.Decompress();
+    const auto elapsed = std::chrono::steady_clock::now() - started;
+    decompress_latency_.Record(elapsed);
+    if (!decompressed) {
+      // Only synced conversations are compressed, so the cache has all of
+      // it. Load it again from there, and sync it as if it were new.
+      SPDLOG_LOGGER_WARN(Log(), "Reloading conversation with {} from the cache",
+                         user_id);
+      user_messages_.erase(user_id);
+      history_sync_->Unsync(user_id);
+      Load(user_id, HistorySync::Priority::Foreground);
+      return user_messages_[user_id];
+    }
+    SPDLOG_LOGGER_INFO(Log(), "Decompressed {} messages with {} in {} ({} KiB)",
+                       conversation.size(), user_id, FormatDuration(elapsed),
+                       saved / 1024);
+  }
+  return conversation;
+}
 
-          SPDLOG_INFO("Fetched {} historical messages for user {}",
-                      messages.size(), user_id);
-          // reverse them, because we want them in reverse chronological.
-          std::reverse(messages.begin(), messages.end());
+void Messages::Load(const uint64_t user_id,
+                    const HistorySync::Priority priority) {
+  if (!history_open_) {
+    return;
+  }
+  if (const auto [conversation, added] = user_messages_.try_emplace(user_id);
+      added) {
+    last_viewed_[user_id] = std::chrono::steady_clock::now();
+    // Show whatever we have on disk straight away, and only fetch what's
+    // missing from it.
+    auto records = cache_->Load(user_id);
+    for (auto& record : records) {
+      PrepareForDisplay(record);
+    }
+    conversation->second.Merge(std::move(records));
+    history_sync_->Sync(user_id, priority);
+  } else if (priority == HistorySync::Priority::Foreground &&
+             history_sync_->IsPending(user_id)) {
+    // A prefetch is waiting, but now the user is too.
+    history_sync_->Sync(user_id, priority);
+  }
+}
 
-          user_messages_[user_id] = messages;
-        });
+std::optional<uint64_t> Messages::ConversationId(
+    const discordpp::MessageHandle& message) const {
+  const auto current_user = client_->GetCurrentUserV2();
+  if (!current_user) {
+    SPDLOG_LOGGER_ERROR(Log(), "Current user not available");
+    return std::nullopt;
+  }
+  // store my own messages against the recipient
+  if (message.AuthorId() == current_user->Id()) {
+    return message.RecipientId();
   }
+  return message.AuthorId();
+}
 
-  return user_messages_[user_id];
+void Messages::SetWidth(const int width) {
+  if (width == width_) {
+    return;
+  }
+  SPDLOG_LOGGER_DEBUG(
+      Log(), "Message width changed from {} to {}, dropping {} layouts",
+      width_, width, rendered_rows_.size());
+  width_ = width;
+  rendered_rows_.clear();
 }
 
-bool Messages::HasUnreadMessages(const uint64_t user_id) const {
-  if (!unread_messages_.contains(user_id)) {
-    return false;
+ftxui::Element Messages::RenderRow(const MessageRecord& message) {
+  if (const auto row = rendered_rows_.find(message.id);
+      row != rendered_rows_.end()) {
+    return row->second;
+  }
+  if (rendered_rows_.size() >= MAX_RENDERED_ROWS) {
+    rendered_rows_.clear();
+  }
+
+  // Display author and message content
+  const auto name = names_->DisplayName(message.author_id);
+  const auto prefix =
+      (name.empty() ? message.author_name : std::string(name)) + ": ";
+  auto author = ftxui::text(prefix) | ftxui::color(ftxui::Color::Cyan);
+  const auto runs = ContentRuns(message);
+  // Leave a column for the scroll indicator
+  const auto width = width_ - 1;
+  if (width <= 0) {
+    StyledLine line(runs.begin(), runs.end());
+    return rendered_rows_[message.id] =
+               ftxui::hbox({author, RenderLine(line)});
+  }
+
+  // Continuation lines hang under the content, unless the name would leave
+  // too little room for it.
+  const auto prefix_width = ftxui::string_width(prefix);
+  const auto indent = prefix_width < width / 2 ? prefix_width : 0;
+  const auto lines =
+      WrapRuns(runs, std::max(width - prefix_width, 1), width - indent);
+  ftxui::Elements rows;
+  rows.reserve(lines.size());
+  rows.push_back(ftxui::hbox({author, RenderLine(lines.front())}));
+  for (size_t i = 1; i < lines.size(); ++i) {
+    rows.push_back(ftxui::hbox(
+        {ftxui::text(std::string(indent, ' ')), RenderLine(lines[i])}));
+  }
+  return rendered_rows_[message.id] = ftxui::vbox(std::move(rows));
+}
+
+std::vector<StyledRun> Messages::ContentRuns(
+    const MessageRecord& message) const {
+  if (message.spans.empty()) {
+    return {{.text = message.content}};
+  }
+  std::vector<StyledRun> runs;
+  runs.reserve(message.spans.size());
+  for (const auto& span : message.spans) {
+    auto& run = runs.emplace_back(StyledRun{
+        .text = message.content.substr(span.offset, span.length),
+        .style = span.style});
+    // Mentions show who they mention, as they're called now.
+    if ((span.style & STYLE_MENTION) != 0) {
+      if (const auto name = names_->DisplayName(span.user_id);
+          !name.empty()) {
+        run.text = std::string("@").append(name);
+      }
+    }
+  }
+  return runs;
+}
+
+void Messages::RecordOpen(const uint64_t user_id) {
+  opened_conversation_ = user_id;
+  ++opens_;
+  const auto warm = IsLoaded(user_id);
+  if (warm) {
+    ++warm_opens_;
   }
-  return unread_messages_.at(user_id);
+  SPDLOG_LOGGER_DEBUG(Log(), "Opened conversation with {} ({}), hit rate {}/{}",
+                      user_id, warm ? "loaded" : "not loaded", warm_opens_,
+                      opens_);
+}
+
+void Messages::TouchConversation(const uint64_t user_id) {
+  std::erase(recent_conversations_, user_id);
+  recent_conversations_.push_front(user_id);
+  if (recent_conversations_.size() > MAX_RECENT_CONVERSATIONS) {
+    recent_conversations_.pop_back();
+  }
+}
+
+void Messages::MergeHistory(
+    const uint64_t user_id,
+    const std::vector<discordpp::MessageHandle>& messages,
+    const bool contiguous) {
+  std::vector<MessageRecord> records;
+  records.reserve(messages.size());
+  for (const auto& message : messages) {
+    records.push_back(ToRecord(message, user_id));
+    // The cache only holds history without gaps.
+    if (contiguous) {
+      cache_->Append(records.back());
+    }
+    search_index_->Add(records.back());
+  }
+
+  // Conversations that haven't been opened will load from the cache later.
+  if (const auto conversation = user_messages_.find(user_id);
+      conversation != user_messages_.end()) {
+    conversation->second.Merge(std::move(records));
+  }
+}
+
+bool Messages::HasUnreadMessages(const uint64_t user_id) const {
+  return UnreadCount(user_id) > 0;
+}
+
+uint32_t Messages::UnreadCount(const uint64_t user_id) const {
+  return unread_.Count(user_id);
 }
 
-void Messages::AddUnreadChangeHandler(std::function<void()> handler) {
+void Messages::AddUnreadChangeHandler(
+    std::function<void(std::span<const uint64_t> user_ids)> handler) {
   unread_change_handlers_.push_back(std::move(handler));
 }
 
-void Messages::OnUnreadChange() const {
+void Messages::OnUnreadChange(const std::span<const uint64_t> user_ids) const {
   for (const auto& handler : unread_change_handlers_) {
-    handler();
+    handler(user_ids);
   }
 }
 
-}  // namespace discord_social_tui
\ No newline at end of file
+}  // namespace discord_social_tui
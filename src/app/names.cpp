@@ -0,0 +1,67 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/names.hpp"
+
+#include <string>
+
+#include "app/sanitize.hpp"
+
+namespace discord_social_tui {
+
+std::string_view Names::Intern(const std::string_view name) {
+  if (const auto existing = strings_.find(name); existing != strings_.end()) {
+    return *existing;
+  }
+  return *strings_.emplace(name).first;
+}
+
+bool Names::Update(const uint64_t user_id, const std::string_view username,
+                   const std::string_view display_name) {
+  // Names are shown as is, so make them safe to draw first.
+  const auto safe = [this](const std::string_view name) {
+    std::string copy(name);
+    return SanitizeText(copy) ? Intern(copy) : Intern(name);
+  };
+  const UserNames names{.username = safe(username),
+                        .display_name = safe(display_name)};
+  const auto [user, added] = users_.try_emplace(user_id, names);
+  if (added) {
+    return true;
+  }
+  // Interned, so comparing pointers is enough.
+  if (user->second.username.data() == names.username.data() &&
+      user->second.display_name.data() == names.display_name.data()) {
+    return false;
+  }
+  user->second = names;
+  ++generation_;
+  return true;
+}
+
+std::string_view Names::Username(const uint64_t user_id) const {
+  const auto user = users_.find(user_id);
+  return user == users_.end() ? std::string_view{} : user->second.username;
+}
+
+std::string_view Names::DisplayName(const uint64_t user_id) const {
+  const auto user = users_.find(user_id);
+  if (user == users_.end()) {
+    return {};
+  }
+  return user->second.display_name.empty() ? user->second.username
+                                           : user->second.display_name;
+}
+
+}  // namespace discord_social_tui
@@ -0,0 +1,207 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/outbound_queue.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace discord_social_tui {
+
+OutboundQueue::OutboundQueue(std::shared_ptr<discordpp::Client> client,
+                             SentHandler on_sent)
+    : client_(std::move(client)), on_sent_(std::move(on_sent)) {}
+
+void OutboundQueue::Send(const uint64_t recipient_id, std::string content) {
+  queues_[recipient_id].push_back(
+      {.local_id = next_local_id_++, .content = std::move(content)});
+  Pump(recipient_id);
+}
+
+void OutboundQueue::SetConnected(const bool connected) {
+  if (connected_ == connected) {
+    return;
+  }
+  connected_ = connected;
+  if (!connected_) {
+    return;
+  }
+
+  // Anything that failed while we were away can go now.
+  size_t waiting = 0;
+  for (auto& [recipient_id, queue] : queues_) {
+    for (auto& message : queue) {
+      if (message.state == State::Retrying) {
+        message.retry_at = Clock::now();
+      }
+      waiting += message.state == State::Failed ? 0 : 1;
+    }
+    Pump(recipient_id);
+  }
+  if (waiting > 0) {
+    SPDLOG_INFO("Connected, flushing {} queued messages", waiting);
+  }
+}
+
+void OutboundQueue::Tick() {
+  const auto now = Clock::now();
+  for (const auto& [recipient_id, queue] : queues_) {
+    if (std::ranges::any_of(queue, [now](const PendingMessage& message) {
+          return message.state == State::Retrying && message.retry_at <= now;
+        })) {
+      Pump(recipient_id);
+    }
+  }
+}
+
+void OutboundQueue::Retry(const uint64_t recipient_id) {
+  const auto queue = queues_.find(recipient_id);
+  if (queue == queues_.end()) {
+    return;
+  }
+  for (auto& message : queue->second) {
+    if (message.state == State::Failed) {
+      message.state = State::Queued;
+      message.attempts = 0;
+    }
+  }
+  Pump(recipient_id);
+}
+
+void OutboundQueue::Discard(const uint64_t recipient_id) {
+  const auto queue = queues_.find(recipient_id);
+  if (queue == queues_.end()) {
+    return;
+  }
+  const auto discarded = std::erase_if(
+      queue->second, [](const PendingMessage& message) {
+        return message.state == State::Failed;
+      });
+  if (discarded > 0) {
+    SPDLOG_INFO("Discarded {} messages that failed to send", discarded);
+  }
+  Pump(recipient_id);
+}
+
+bool OutboundQueue::HasFailed(const uint64_t recipient_id) const {
+  const auto& pending = GetPending(recipient_id);
+  return std::ranges::find(pending, State::Failed, &PendingMessage::state) !=
+         pending.end();
+}
+
+const std::deque<OutboundQueue::PendingMessage>& OutboundQueue::GetPending(
+    const uint64_t recipient_id) const {
+  static const std::deque<PendingMessage> NONE;
+  const auto queue = queues_.find(recipient_id);
+  return queue == queues_.end() ? NONE : queue->second;
+}
+
+void OutboundQueue::Pump(const uint64_t recipient_id) {
+  if (!connected_) {
+    return;
+  }
+
+  auto& queue = queues_[recipient_id];
+  const auto now = Clock::now();
+  size_t in_flight = std::ranges::count(queue, State::Sending,
+                                        &PendingMessage::state);
+  for (auto& message : queue) {
+    // Nothing overtakes a message that gave up, or one waiting to retry.
+    if (in_flight >= PIPELINE_DEPTH || message.state == State::Failed ||
+        (message.state == State::Retrying && message.retry_at > now)) {
+      break;
+    }
+    if (message.state != State::Sending) {
+      Issue(recipient_id, message);
+      ++in_flight;
+    }
+    // Once a message has failed, it goes alone until it is accepted.
+    if (message.failed) {
+      break;
+    }
+  }
+}
+
+void OutboundQueue::Issue(const uint64_t recipient_id,
+                          PendingMessage& message) {
+  message.state = State::Sending;
+  ++message.attempts;
+  client_->SendUserMessage(
+      recipient_id, message.content,
+      [this, recipient_id, local_id = message.local_id](
+          const discordpp::ClientResult& result, const uint64_t message_id) {
+        Complete(recipient_id, local_id, result, message_id);
+      });
+}
+
+void OutboundQueue::Complete(const uint64_t recipient_id,
+                             const uint64_t local_id,
+                             const discordpp::ClientResult& result,
+                             const uint64_t message_id) {
+  auto& queue = queues_[recipient_id];
+  const auto message =
+      std::ranges::find(queue, local_id, &PendingMessage::local_id);
+  if (message == queue.end()) {
+    return;
+  }
+
+  if (result.Successful()) {
+    SPDLOG_INFO("Message sent: {}", message_id);
+    queue.erase(message);
+    on_sent_(recipient_id, message_id);
+    Pump(recipient_id);
+    return;
+  }
+
+  message->failed = true;
+  // Losing the connection isn't the message's fault, so it doesn't count.
+  if (!connected_) {
+    --message->attempts;
+  }
+  if ((!connected_ || result.Retryable()) &&
+      message->attempts < MAX_ATTEMPTS) {
+    auto backoff = std::min(INITIAL_BACKOFF * (1 << message->attempts),
+                            std::chrono::milliseconds(MAX_BACKOFF));
+    const auto retry_after =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::duration<float>(result.RetryAfter()));
+    backoff = std::max(backoff, retry_after);
+    message->state = State::Retrying;
+    message->retry_at = Clock::now() + backoff;
+    SPDLOG_WARN("Failed to send message, retrying in {}ms: {}",
+                backoff.count(), result.Error());
+  } else {
+    message->state = State::Failed;
+    SPDLOG_ERROR("Failed to send message: {}", result.Error());
+  }
+  Pump(recipient_id);
+}
+
+std::string DescribeState(const OutboundQueue::PendingMessage& message) {
+  switch (message.state) {
+    case OutboundQueue::State::Queued:
+      return "queued";
+    case OutboundQueue::State::Sending:
+      return "sending";
+    case OutboundQueue::State::Retrying:
+      return "retrying";
+    case OutboundQueue::State::Failed:
+      return "failed to send";
+  }
+  return "";
+}
+
+}  // namespace discord_social_tui
@@ -0,0 +1,48 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/paths.hpp"
+
+#include <cstdlib>
+
+namespace discord_social_tui {
+
+namespace {
+constexpr auto APP_DIRECTORY = "discord-social-tui";
+}  // namespace
+
+std::filesystem::path CacheDirectory() {
+  if (const char* xdg_cache = std::getenv("XDG_CACHE_HOME");
+      xdg_cache != nullptr && *xdg_cache != '\0') {
+    return std::filesystem::path(xdg_cache) / APP_DIRECTORY;
+  }
+  if (const char* home = std::getenv("HOME"); home != nullptr) {
+    return std::filesystem::path(home) / ".cache" / APP_DIRECTORY;
+  }
+  // No home directory, so keep it next to wherever we were launched.
+  return std::filesystem::path(".cache") / APP_DIRECTORY;
+}
+
+std::filesystem::path ConfigDirectory() {
+  if (const char* xdg_config = std::getenv("XDG_CONFIG_HOME");
+      xdg_config != nullptr && *xdg_config != '\0') {
+    return std::filesystem::path(xdg_config) / APP_DIRECTORY;
+  }
+  if (const char* home = std::getenv("HOME"); home != nullptr) {
+    return std::filesystem::path(home) / ".config" / APP_DIRECTORY;
+  }
+  return std::filesystem::path(".config") / APP_DIRECTORY;
+}
+
+}  // namespace discord_social_tui
@@ -0,0 +1,77 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/prefetcher.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <utility>
+
+namespace discord_social_tui {
+
+Prefetcher::Prefetcher(std::shared_ptr<Friends> friends,
+                       std::shared_ptr<Messages> messages)
+    : friends_(std::move(friends)), messages_(std::move(messages)) {}
+
+void Prefetcher::Tick() {
+  const auto now = Clock::now();
+  if (now - last_tick_ < INTERVAL) {
+    return;
+  }
+  last_tick_ = now;
+
+  std::erase_if(in_flight_, [this](const uint64_t user_id) {
+    return !messages_->IsLoading(user_id);
+  });
+  // Keep out of the way while the user is typing.
+  if (messages_->IsTyping()) {
+    return;
+  }
+
+  for (const auto user_id : Candidates()) {
+    if (in_flight_.size() >= MAX_IN_FLIGHT) {
+      break;
+    }
+    if (messages_->IsLoaded(user_id) || messages_->IsLoading(user_id)) {
+      continue;
+    }
+    SPDLOG_DEBUG("Prefetching conversation with {}", user_id);
+    messages_->Prefetch(user_id);
+    in_flight_.insert(user_id);
+  }
+}
+
+std::vector<uint64_t> Prefetcher::Candidates() const {
+  std::vector<uint64_t> candidates = messages_->UnreadConversations();
+
+  // Friends near the selection are the most likely to be opened next.
+  // Headers have no friend, and are skipped.
+  const auto selected = friends_->GetSelectedIndex();
+  for (size_t distance = 1; distance <= NEIGHBOURS; ++distance) {
+    if (const auto below = friends_->GetFriendAt(selected + distance)) {
+      candidates.push_back(below.value()->GetId());
+    }
+    if (selected >= distance) {
+      if (const auto above = friends_->GetFriendAt(selected - distance)) {
+        candidates.push_back(above.value()->GetId());
+      }
+    }
+  }
+
+  const auto& recent = messages_->RecentConversations();
+  candidates.insert(candidates.end(), recent.begin(), recent.end());
+  return candidates;
+}
+
+}  // namespace discord_social_tui
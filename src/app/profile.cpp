@@ -32,23 +32,23 @@ ftxui::Component Profile::Render() const {
   // Create a container with profile sections
   return ftxui::Renderer([this] {
     // grab the currently selected friend
-    const auto user_handle = this->friends_->GetSelectedFriend().and_then(
-        [](const std::shared_ptr<Friend>& selected_friend)
-            -> std::optional<discordpp::UserHandle> {
-          return selected_friend->GetUserHandle();
-        });
-
-    if (!user_handle) {
+    const auto selected_friend = this->friends_->GetSelectedFriend();
+    if (!selected_friend) {
       return RenderEmptyProfile();
     }
 
-    return ftxui::vbox({
-        RenderUserInfo(user_handle.value()),
-        ftxui::separator(),
-        RenderStatusInfo(user_handle.value()),
+    const auto& friend_ = *selected_friend.value();
+    ftxui::Elements sections = {
+        RenderUserInfo(friend_),
         ftxui::separator(),
-        RenderRelationshipInfo(user_handle.value()),
-    });
+        RenderStatusInfo(friend_.GetStatus()),
+    };
+    // Friends from the last run's snapshot have no handle until we connect.
+    if (const auto& user_handle = friend_.GetUserHandle()) {
+      sections.push_back(ftxui::separator());
+      sections.push_back(RenderRelationshipInfo(user_handle.value()));
+    }
+    return ftxui::vbox(std::move(sections));
   });
 }
 
@@ -60,13 +60,11 @@ ftxui::Element Profile::RenderEmptyProfile() {
   });
 }
 
-ftxui::Element Profile::RenderUserInfo(
-    const discordpp::UserHandle& user_handle) {
-  // Get user information
-  const auto username = user_handle.Username();
-  const auto display_name = user_handle.DisplayName();
-  const auto user_id = std::to_string(user_handle.Id());
-  const bool is_provisional = user_handle.IsProvisional();
+ftxui::Element Profile::RenderUserInfo(const Friend& friend_) {
+  // Get user information. Names are interned, so there's nothing to copy.
+  const auto username = friend_.GetUsername();
+  const auto display_name = friend_.GetDisplayName();
+  const auto user_id = std::to_string(friend_.GetId());
 
   // Build elements for the user info section
   std::vector<ftxui::Element> elements = {
@@ -74,14 +72,15 @@ ftxui::Element Profile::RenderUserInfo(
       ftxui::text(""),
       ftxui::hbox({
           ftxui::text("Username: ") | ftxui::bold,
-          ftxui::text(username),
+          ftxui::text(std::string(username)),
       })};
 
-  // Only add display name if it's different from username
-  if (!display_name.empty() && display_name != username) {
+  // Only add display name if it's different from username. Interned names
+  // are the same name exactly when they're the same string.
+  if (!display_name.empty() && display_name.data() != username.data()) {
     elements.push_back(ftxui::hbox({
         ftxui::text("Display Name: ") | ftxui::bold,
-        ftxui::text(display_name),
+        ftxui::text(std::string(display_name)),
     }));
   }
 
@@ -91,25 +90,27 @@ ftxui::Element Profile::RenderUserInfo(
       ftxui::text(user_id),
   }));
 
-  // Add provisional status with appropriate styling
-  elements.push_back(ftxui::hbox({
-      ftxui::text("Provisional: ") | ftxui::bold,
-      is_provisional ? ftxui::text("Yes") | ftxui::color(ftxui::Color::Yellow)
-                     : ftxui::text("No") | ftxui::color(ftxui::Color::Green),
-  }));
+  // Add provisional status with appropriate styling, once it's known
+  if (const auto& user_handle = friend_.GetUserHandle()) {
+    const bool is_provisional = user_handle->IsProvisional();
+    elements.push_back(ftxui::hbox({
+        ftxui::text("Provisional: ") | ftxui::bold,
+        is_provisional
+            ? ftxui::text("Yes") | ftxui::color(ftxui::Color::Yellow)
+            : ftxui::text("No") | ftxui::color(ftxui::Color::Green),
+    }));
+  }
 
   // Create a vbox with all elements
   return ftxui::vbox(elements);
 }
 
-ftxui::Element Profile::RenderStatusInfo(
-    const discordpp::UserHandle& user_handle) {
-  const auto& handle = user_handle;
+ftxui::Element Profile::RenderStatusInfo(const discordpp::StatusType status) {
   std::string status_text;
   ftxui::Color status_color;
 
   // Determine status text and color
-  switch (handle.Status()) {
+  switch (status) {
     case discordpp::StatusType::Online:
       status_text = "Online";
       status_color = ftxui::Color::Green;
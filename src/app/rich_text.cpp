@@ -0,0 +1,297 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/rich_text.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <optional>
+#include <system_error>
+#include <utility>
+
+namespace discord_social_tui {
+
+namespace {
+
+struct Delimiter {
+  std::string_view marker;
+  uint16_t style;
+};
+
+// Longest first, so ** is never taken for two *.
+constexpr std::array<Delimiter, 6> DELIMITERS = {{
+    {.marker = "**", .style = STYLE_BOLD},
+    {.marker = "__", .style = STYLE_UNDERLINE},
+    {.marker = "~~", .style = STYLE_STRIKETHROUGH},
+    {.marker = "||", .style = STYLE_SPOILER},
+    {.marker = "*", .style = STYLE_ITALIC},
+    {.marker = "_", .style = STYLE_ITALIC},
+}};
+
+constexpr std::array<std::string_view, 2> URL_SCHEMES = {"https://",
+                                                         "http://"};
+
+bool IsWordCharacter(const char character) {
+  return std::isalnum(static_cast<unsigned char>(character)) != 0;
+}
+
+bool IsSpace(const char character) {
+  return std::isspace(static_cast<unsigned char>(character)) != 0;
+}
+
+// Walks the content once, cutting it into spans wherever the style changes
+// or markup has to be left out.
+class Parser {
+ public:
+  explicit Parser(const std::string_view content) : content_(content) {}
+
+  std::vector<TextSpan> Parse() {
+    while (position_ < content_.size()) {
+      if (!(Escape() || CodeSpan("```") || CodeSpan("`") || Mention() ||
+            Emoji() || Link() || Toggle())) {
+        ++position_;
+      }
+    }
+    EndRun(position_);
+    if (!markup_) {
+      return {};
+    }
+    return std::move(spans_);
+  }
+
+ private:
+  std::string_view content_;
+  size_t position_ = 0;
+  size_t run_start_ = 0;
+  uint16_t style_ = 0;
+  // Which marker opened italics, since * and _ both can
+  std::string_view italic_marker_;
+  bool markup_ = false;
+  std::vector<TextSpan> spans_;
+
+  void EndRun(const size_t end) {
+    if (end > run_start_) {
+      AddSpan(run_start_, end - run_start_, style_);
+    }
+  }
+
+  void AddSpan(const size_t offset, const size_t length, const uint16_t style,
+               const uint64_t user_id = 0) {
+    spans_.push_back({.offset = static_cast<uint32_t>(offset),
+                      .length = static_cast<uint32_t>(length),
+                      .style = style,
+                      .user_id = user_id});
+  }
+
+  // Leave out length bytes of markup at the current position.
+  void SkipMarkup(const size_t length) {
+    EndRun(position_);
+    position_ += length;
+    run_start_ = position_;
+    markup_ = true;
+  }
+
+  [[nodiscard]] bool At(const std::string_view text) const {
+    return content_.substr(position_).starts_with(text);
+  }
+
+  // \* and the like show the character itself.
+  bool Escape() {
+    if (content_[position_] != '\\' || position_ + 1 >= content_.size() ||
+        std::ispunct(static_cast<unsigned char>(content_[position_ + 1])) ==
+            0) {
+      return false;
+    }
+    SkipMarkup(1);
+    // Step over the escaped character, so it isn't taken as markup.
+    ++position_;
+    return true;
+  }
+
+  // Nothing inside code is parsed.
+  bool CodeSpan(const std::string_view fence) {
+    if (!At(fence)) {
+      return false;
+    }
+    const auto close = content_.find(fence, position_ + fence.size());
+    if (close == std::string_view::npos ||
+        close == position_ + fence.size()) {
+      return false;
+    }
+    SkipMarkup(fence.size());
+    auto body = content_.substr(position_, close - position_);
+    if (fence.size() > 1) {
+      // Blocks can name their language on the first line, and usually sit
+      // on lines of their own.
+      if (const auto first_line = body.find('\n');
+          first_line != std::string_view::npos &&
+          std::all_of(body.begin(),
+                      body.begin() + static_cast<long>(first_line),
+                      [](const char character) {
+                        return IsWordCharacter(character) ||
+                               character == '+' || character == '-';
+                      })) {
+        position_ += first_line + 1;
+        body.remove_prefix(first_line + 1);
+      }
+      if (body.ends_with('\n')) {
+        body.remove_suffix(1);
+      }
+    }
+    if (!body.empty()) {
+      AddSpan(position_, body.size(), style_ | STYLE_CODE);
+    }
+    position_ = close;
+    run_start_ = position_;
+    SkipMarkup(fence.size());
+    return true;
+  }
+
+  // Reads digits up to a closing '>', returning the number and where the
+  // tag ends.
+  [[nodiscard]] std::optional<std::pair<uint64_t, size_t>> TagId(
+      const size_t start) const {
+    uint64_t id = 0;
+    const auto* begin = content_.data() + start;
+    const auto* end = content_.data() + content_.size();
+    const auto [ptr, error] = std::from_chars(begin, end, id);
+    if (error != std::errc{} || ptr == begin || ptr == end || *ptr != '>') {
+      return std::nullopt;
+    }
+    return std::pair{id, static_cast<size_t>(ptr - content_.data()) + 1};
+  }
+
+  // <@123> or <@!123>
+  bool Mention() {
+    if (!At("<@")) {
+      return false;
+    }
+    auto start = position_ + 2;
+    if (start < content_.size() && content_[start] == '!') {
+      ++start;
+    }
+    const auto tag = TagId(start);
+    if (!tag) {
+      return false;
+    }
+    EndRun(position_);
+    AddSpan(position_, tag->second - position_, style_ | STYLE_MENTION,
+            tag->first);
+    position_ = run_start_ = tag->second;
+    markup_ = true;
+    return true;
+  }
+
+  // <:name:123> or, when animated, <a:name:123>
+  bool Emoji() {
+    size_t name_start = 0;
+    if (At("<:")) {
+      name_start = position_ + 1;
+    } else if (At("<a:")) {
+      name_start = position_ + 2;
+    } else {
+      return false;
+    }
+    const auto name_end = content_.find(':', name_start + 1);
+    if (name_end == std::string_view::npos || name_end == name_start + 1 ||
+        !std::all_of(content_.begin() + static_cast<long>(name_start) + 1,
+                     content_.begin() + static_cast<long>(name_end),
+                     [](const char character) {
+                       return IsWordCharacter(character) || character == '_';
+                     })) {
+      return false;
+    }
+    const auto tag = TagId(name_end + 1);
+    if (!tag) {
+      return false;
+    }
+    EndRun(position_);
+    // Drawn as :name:, which is already in the tag.
+    AddSpan(name_start, name_end + 1 - name_start, style_ | STYLE_EMOJI);
+    position_ = run_start_ = tag->second;
+    markup_ = true;
+    return true;
+  }
+
+  bool Link() {
+    if (position_ > 0 && !IsSpace(content_[position_ - 1]) &&
+        content_[position_ - 1] != '(' && content_[position_ - 1] != '<') {
+      return false;
+    }
+    if (std::ranges::none_of(URL_SCHEMES, [this](const auto scheme) {
+          return At(scheme);
+        })) {
+      return false;
+    }
+    auto end = position_;
+    while (end < content_.size() && !IsSpace(content_[end])) {
+      ++end;
+    }
+    // Punctuation after a link is usually part of the sentence.
+    while (end > position_ &&
+           std::string_view(".,;:!?)>'\"").contains(content_[end - 1])) {
+      --end;
+    }
+    EndRun(position_);
+    AddSpan(position_, end - position_, style_ | STYLE_LINK);
+    position_ = run_start_ = end;
+    markup_ = true;
+    return true;
+  }
+
+  // Markers toggle their style, but only open if they're closed later on.
+  bool Toggle() {
+    for (const auto& [marker, style] : DELIMITERS) {
+      if (!At(marker)) {
+        continue;
+      }
+      const auto is_italic = style == STYLE_ITALIC;
+      if ((style_ & style) != 0) {
+        if (is_italic && marker != italic_marker_) {
+          continue;
+        }
+        SkipMarkup(marker.size());
+        style_ &= ~style;
+        return true;
+      }
+
+      const auto after = position_ + marker.size();
+      // snake_case isn't italics, and neither is a marker before a space.
+      if ((marker == "_" && position_ > 0 &&
+           IsWordCharacter(content_[position_ - 1])) ||
+          after >= content_.size() || IsSpace(content_[after]) ||
+          content_.find(marker, after + 1) == std::string_view::npos) {
+        continue;
+      }
+      SkipMarkup(marker.size());
+      style_ |= style;
+      if (is_italic) {
+        italic_marker_ = marker;
+      }
+      return true;
+    }
+    return false;
+  }
+};
+
+}  // namespace
+
+std::vector<TextSpan> ParseRichText(const std::string_view content) {
+  return Parser(content).Parse();
+}
+
+}  // namespace discord_social_tui
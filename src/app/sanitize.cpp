@@ -0,0 +1,285 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/sanitize.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace discord_social_tui {
+
+namespace {
+
+constexpr unsigned char ESC = 0x1B;
+constexpr unsigned char BEL = 0x07;
+constexpr unsigned char DEL = 0x7F;
+constexpr std::string_view REPLACEMENT = "�";
+
+// Printable ASCII and newlines need no attention.
+bool IsPlain(const unsigned char byte) {
+  return (byte >= 0x20 && byte < DEL) || byte == '\n';
+}
+
+#if defined(__AVX2__)
+// Length of the run of plain bytes at the start of the text.
+size_t PlainRun(const std::string_view text) {
+  const auto space = _mm256_set1_epi8(0x20);
+  const auto newline = _mm256_set1_epi8('\n');
+  const auto del = _mm256_set1_epi8(static_cast<char>(DEL));
+  size_t i = 0;
+  for (; i + sizeof(__m256i) <= text.size(); i += sizeof(__m256i)) {
+    const auto bytes = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(text.data() + i));
+    // A signed compare, so bytes from 0x80 up count as less than a space.
+    const auto control = _mm256_cmpgt_epi8(space, bytes);
+    const auto unusual = _mm256_or_si256(
+        _mm256_andnot_si256(_mm256_cmpeq_epi8(bytes, newline), control),
+        _mm256_cmpeq_epi8(bytes, del));
+    if (const auto mask =
+            static_cast<uint32_t>(_mm256_movemask_epi8(unusual));
+        mask != 0) {
+      return i + static_cast<size_t>(std::countr_zero(mask));
+    }
+  }
+  while (i < text.size() && IsPlain(static_cast<unsigned char>(text[i]))) {
+    ++i;
+  }
+  return i;
+}
+#elif defined(__SSE2__)
+size_t PlainRun(const std::string_view text) {
+  const auto space = _mm_set1_epi8(0x20);
+  const auto newline = _mm_set1_epi8('\n');
+  const auto del = _mm_set1_epi8(static_cast<char>(DEL));
+  size_t i = 0;
+  for (; i + sizeof(__m128i) <= text.size(); i += sizeof(__m128i)) {
+    const auto bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+    // A signed compare, so bytes from 0x80 up count as less than a space.
+    const auto control = _mm_cmplt_epi8(bytes, space);
+    const auto unusual =
+        _mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi8(bytes, newline), control),
+                     _mm_cmpeq_epi8(bytes, del));
+    if (const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(unusual));
+        mask != 0) {
+      return i + static_cast<size_t>(std::countr_zero(mask));
+    }
+  }
+  while (i < text.size() && IsPlain(static_cast<unsigned char>(text[i]))) {
+    ++i;
+  }
+  return i;
+}
+#else
+size_t PlainRun(const std::string_view text) {
+  size_t i = 0;
+  while (i < text.size() && IsPlain(static_cast<unsigned char>(text[i]))) {
+    ++i;
+  }
+  return i;
+}
+#endif
+
+bool IsContinuation(const std::string_view text, const size_t position,
+                    const unsigned char low = 0x80,
+                    const unsigned char high = 0xBF) {
+  if (position >= text.size()) {
+    return false;
+  }
+  const auto byte = static_cast<unsigned char>(text[position]);
+  return byte >= low && byte <= high;
+}
+
+// Length of the valid UTF-8 sequence at position. If it's invalid, returns
+// 0 and sets invalid to how many bytes to replace: the lead byte and any
+// continuation bytes that were valid up to that point.
+size_t Utf8Length(const std::string_view text, const size_t position,
+                  size_t& invalid) {
+  const auto lead = static_cast<unsigned char>(text[position]);
+  size_t length = 0;
+  // The range of the second byte rules out overlong encodings, surrogates
+  // and anything past U+10FFFF.
+  unsigned char low = 0x80;
+  unsigned char high = 0xBF;
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    length = 2;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 3;
+    low = lead == 0xE0 ? 0xA0 : low;
+    high = lead == 0xED ? 0x9F : high;
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 4;
+    low = lead == 0xF0 ? 0x90 : low;
+    high = lead == 0xF4 ? 0x8F : high;
+  } else {
+    invalid = 1;
+    return 0;
+  }
+
+  for (size_t i = 1; i < length; ++i) {
+    if (!IsContinuation(text, position + i, i == 1 ? low : 0x80,
+                        i == 1 ? high : 0xBF)) {
+      invalid = i;
+      return 0;
+    }
+  }
+  return length;
+}
+
+// C1 control characters (U+0080 to U+009F), which some terminals act on
+// just like their escape sequence equivalents.
+bool IsC1(const std::string_view text, const size_t position) {
+  return static_cast<unsigned char>(text[position]) == 0xC2 &&
+         IsContinuation(text, position + 1, 0x80, 0x9F);
+}
+
+// Position of the first byte that needs changing, from position on.
+size_t FindUnsafe(const std::string_view text, size_t position) {
+  while (true) {
+    position += PlainRun(text.substr(position));
+    if (position >= text.size()) {
+      return std::string_view::npos;
+    }
+    if (static_cast<unsigned char>(text[position]) < 0x80) {
+      return position;
+    }
+    size_t invalid = 0;
+    const auto length = Utf8Length(text, position, invalid);
+    if (length == 0 || IsC1(text, position)) {
+      return position;
+    }
+    position += length;
+  }
+}
+
+// Skip a control string (OSC, DCS and the like) up to and including its
+// terminator: BEL, ESC \ or C1 ST. An unterminated one runs to the end.
+size_t SkipControlString(const std::string_view text, size_t position) {
+  for (; position < text.size(); ++position) {
+    const auto byte = static_cast<unsigned char>(text[position]);
+    if (byte == BEL) {
+      return position + 1;
+    }
+    if (byte == ESC && position + 1 < text.size() &&
+        text[position + 1] == '\\') {
+      return position + 2;
+    }
+    if (byte == 0xC2 && position + 1 < text.size() &&
+        static_cast<unsigned char>(text[position + 1]) == 0x9C) {
+      return position + 2;
+    }
+  }
+  return position;
+}
+
+// Skip a CSI sequence's parameters and intermediates, up to and including
+// its final byte.
+size_t SkipCsi(const std::string_view text, size_t position) {
+  for (; position < text.size(); ++position) {
+    const auto byte = static_cast<unsigned char>(text[position]);
+    if (byte >= 0x40 && byte <= 0x7E) {
+      return position + 1;
+    }
+    if (byte < 0x20 || byte > 0x3F) {
+      // Not part of a sequence, so leave it to be dealt with on its own.
+      return position;
+    }
+  }
+  return position;
+}
+
+// Skip whatever a sequence introduced by this byte covers. Introducers are
+// the same whether they follow ESC or are sent as C1 controls.
+size_t SkipSequence(const std::string_view text, const unsigned char introducer,
+                    const size_t position) {
+  switch (introducer) {
+    case '[':
+      return SkipCsi(text, position);
+    case ']':
+    case 'P':
+    case 'X':
+    case '^':
+    case '_':
+      return SkipControlString(text, position);
+    default:
+      return position;
+  }
+}
+
+}  // namespace
+
+bool SanitizeText(std::string& text) {
+  auto unsafe = FindUnsafe(text, 0);
+  if (unsafe == std::string_view::npos) {
+    return false;
+  }
+
+  const std::string_view input = text;
+  std::string output;
+  output.reserve(text.size());
+  size_t position = 0;
+  while (unsafe != std::string_view::npos) {
+    output.append(input.substr(position, unsafe - position));
+    position = unsafe;
+    const auto byte = static_cast<unsigned char>(input[position]);
+    if (byte == ESC) {
+      position += 1;
+      if (position < input.size()) {
+        const auto introducer = static_cast<unsigned char>(input[position]);
+        // Two byte sequences are just ESC and one printable character.
+        position = introducer >= 0x20 && introducer < DEL
+                       ? SkipSequence(input, introducer, position + 1)
+                       : position;
+      }
+    } else if (byte == '\t') {
+      output.push_back(' ');
+      position += 1;
+    } else if (byte < 0x80) {
+      // Any other C0 control, or DEL
+      position += 1;
+    } else if (IsC1(input, position)) {
+      // 0x40 less than its C1 code is the equivalent ESC introducer.
+      const auto introducer = static_cast<unsigned char>(
+          static_cast<unsigned char>(input[position + 1]) - 0x40);
+      position = SkipSequence(input, introducer, position + 2);
+    } else {
+      size_t invalid = 0;
+      const auto length = Utf8Length(input, position, invalid);
+      output.append(REPLACEMENT);
+      position += length == 0 ? invalid : length;
+    }
+    unsafe = FindUnsafe(input, position);
+  }
+  output.append(input.substr(position));
+  text = std::move(output);
+  return true;
+}
+
+void Sanitize(MessageRecord& record) {
+  if (record.sanitized) {
+    return;
+  }
+  SanitizeText(record.content);
+  SanitizeText(record.author_name);
+  record.sanitized = true;
+}
+
+}  // namespace discord_social_tui
@@ -0,0 +1,134 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/search.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <utility>
+
+#include "app/sanitize.hpp"
+#include "app/stats.hpp"
+#include "ftxui/component/event.hpp"
+#include "ftxui/dom/elements.hpp"
+
+namespace discord_social_tui {
+
+Search::Search(std::shared_ptr<SearchIndex> index,
+               std::shared_ptr<MessageCache> cache,
+               std::shared_ptr<Friends> friends)
+    : index_(std::move(index)),
+      cache_(std::move(cache)),
+      friends_(std::move(friends)),
+      results_(ftxui::Container::Vertical(std::vector<ftxui::Component>{},
+                                          &selected_)) {
+  auto option = ftxui::InputOption();
+  option.multiline = false;
+  // Search as you type, the index is fast enough
+  option.on_change = [this]() { RunQuery(); };
+  option.on_enter = [this]() { OnResultSelected(); };
+  input_component_ =
+      ftxui::Input(&query_, "Search all messages...", std::move(option));
+}
+
+ftxui::Component Search::Render() {
+  const auto container =
+      ftxui::Container::Vertical({input_component_, results_});
+
+  const auto component = ftxui::Renderer(container, [this] {
+    return ftxui::vbox({
+        ftxui::hbox({ftxui::text("🔍 ") | ftxui::bold,
+                     input_component_->Render() | ftxui::flex}),
+        ftxui::separator(),
+        ftxui::text(status_) | ftxui::dim,
+        results_->Render() | ftxui::vscroll_indicator | ftxui::yframe |
+            ftxui::flex,
+    });
+  });
+
+  return component | ftxui::CatchEvent([this](const ftxui::Event& event) {
+           if (event == ftxui::Event::Return && results_->Focused()) {
+             OnResultSelected();
+             return true;
+           }
+           return false;
+         });
+}
+
+void Search::AddResultSelectedHandler(
+    std::function<void(uint64_t conversation_id, uint64_t message_id)>
+        handler) {
+  result_selected_handlers_.push_back(std::move(handler));
+}
+
+void Search::RunQuery() {
+  const auto started = std::chrono::steady_clock::now();
+  hits_ = index_->Search(query_, MAX_RESULTS);
+  const auto elapsed = std::chrono::steady_clock::now() - started;
+
+  selected_ = 0;
+  results_->DetachAllChildren();
+  for (const auto& hit : hits_) {
+    results_->Add(ftxui::MenuEntry(ResultLabel(hit)));
+  }
+
+  status_ = query_.empty()
+                ? ""
+                : std::to_string(hits_.size()) + " results in " +
+                      FormatDuration(elapsed) + " across " +
+                      std::to_string(index_->size()) + " messages";
+  SPDLOG_DEBUG("Search for '{}' found {} results in {}", query_, hits_.size(),
+               FormatDuration(elapsed));
+}
+
+std::string Search::ResultLabel(const SearchHit& hit) {
+  const auto name =
+      friends_->GetFriendById(hit.conversation_id)
+          .transform([](const std::shared_ptr<Friend>& friend_) {
+            return std::string(friend_->GetDisplayName());
+          })
+          .value_or(std::to_string(hit.conversation_id));
+
+  // Only the hits we show are read back from disk.
+  auto snippet = cache_->Get(hit.message_id)
+                     .transform([](MessageRecord record) {
+                       Sanitize(record);
+                       return record.author_name + ": " + record.content;
+                     })
+                     .value_or("");
+  if (snippet.size() > SNIPPET_LENGTH) {
+    // Don't cut a multi-byte character in half
+    auto length = SNIPPET_LENGTH;
+    while (length > 0 && (static_cast<unsigned char>(snippet[length]) &
+                          0xC0U) == 0x80U) {
+      --length;
+    }
+    snippet.resize(length);
+    snippet += "…";
+  }
+  return name + " │ " + snippet;
+}
+
+void Search::OnResultSelected() const {
+  if (selected_ < 0 || static_cast<size_t>(selected_) >= hits_.size()) {
+    return;
+  }
+  const auto& hit = hits_[selected_];
+  for (const auto& handler : result_selected_handlers_) {
+    handler(hit.conversation_id, hit.message_id);
+  }
+}
+
+}  // namespace discord_social_tui
@@ -0,0 +1,445 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/search_index.hpp"
+
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <system_error>
+
+namespace discord_social_tui {
+
+namespace {
+
+constexpr std::string_view INDEX_MAGIC = "DSSI";
+constexpr uint64_t INDEX_VERSION = 1;
+
+constexpr mode_t FILE_MODE = S_IRUSR | S_IWUSR;
+
+// Tokens shorter than this aren't worth a posting list.
+constexpr size_t MIN_TOKEN_LENGTH = 2;
+// Very long "words" are usually links or noise, so only index a prefix.
+constexpr size_t MAX_TOKEN_LENGTH = 64;
+
+// BM25 ranking parameters
+constexpr double BM25_K1 = 1.2;
+constexpr double BM25_B = 0.75;
+
+void PutVarint(std::string& out, uint64_t value) {
+  constexpr uint64_t CONTINUATION = 0x80;
+  while (value >= CONTINUATION) {
+    out.push_back(static_cast<char>((value & (CONTINUATION - 1)) |
+                                    CONTINUATION));
+    value >>= 7U;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+// Reads varints back out of a saved index, failing rather than reading past
+// the end.
+class VarintReader {
+ public:
+  explicit VarintReader(std::string_view data) : data_(data) {}
+
+  std::optional<uint64_t> Next() {
+    constexpr uint64_t CONTINUATION = 0x80;
+    constexpr unsigned MAX_SHIFT = 63;
+    uint64_t value = 0;
+    for (unsigned shift = 0; offset_ < data_.size() && shift <= MAX_SHIFT;
+         shift += 7) {
+      const auto byte = static_cast<uint8_t>(data_[offset_++]);
+      value |= static_cast<uint64_t>(byte & (CONTINUATION - 1)) << shift;
+      if ((byte & CONTINUATION) == 0) {
+        return value;
+      }
+    }
+    return std::nullopt;
+  }
+
+  std::optional<std::string_view> Bytes(const uint64_t length) {
+    if (data_.size() - offset_ < length) {
+      return std::nullopt;
+    }
+    const auto bytes = data_.substr(offset_, length);
+    offset_ += length;
+    return bytes;
+  }
+
+ private:
+  std::string_view data_;
+  size_t offset_ = 0;
+};
+
+}  // namespace
+
+std::vector<std::string> SearchIndex::Tokenize(const std::string_view text) {
+  std::vector<std::string> tokens;
+  std::string token;
+  const auto flush = [&tokens, &token] {
+    if (token.size() >= MIN_TOKEN_LENGTH) {
+      tokens.push_back(token);
+    }
+    token.clear();
+  };
+
+  for (const char character : text) {
+    const auto byte = static_cast<unsigned char>(character);
+    // Bytes of multi-byte UTF-8 sequences are kept as part of the word, so
+    // non-ASCII text is searchable even though it isn't case-folded.
+    if (std::isalnum(byte) != 0 || byte >= 0x80) {
+      if (token.size() < MAX_TOKEN_LENGTH) {
+        token.push_back(static_cast<char>(std::tolower(byte)));
+      }
+    } else {
+      flush();
+    }
+  }
+  flush();
+  return tokens;
+}
+
+void SearchIndex::Open(const std::filesystem::path& path) {
+  path_ = path;
+  postings_.clear();
+  documents_.clear();
+  total_length_ = 0;
+  dirty_ = false;
+
+  if (!std::filesystem::exists(path_)) {
+    return;
+  }
+  if (!Load(path_)) {
+    SPDLOG_WARN("Search index {} is unreadable, rebuilding it", path_.string());
+    postings_.clear();
+    documents_.clear();
+    total_length_ = 0;
+    return;
+  }
+  SPDLOG_INFO("Loaded search index with {} messages and {} terms",
+              documents_.size(), postings_.size());
+}
+
+void SearchIndex::Save() {
+  if (!dirty_ || path_.empty()) {
+    return;
+  }
+
+  std::string out(INDEX_MAGIC);
+  PutVarint(out, INDEX_VERSION);
+
+  // Documents, sorted by ID so the IDs delta-encode into a byte or two.
+  std::vector<std::pair<uint64_t, Document>> documents(documents_.begin(),
+                                                       documents_.end());
+  std::ranges::sort(documents, {}, &std::pair<uint64_t, Document>::first);
+  PutVarint(out, documents.size());
+  uint64_t previous = 0;
+  for (const auto& [message_id, document] : documents) {
+    PutVarint(out, message_id - previous);
+    PutVarint(out, document.conversation_id);
+    PutVarint(out, document.length);
+    previous = message_id;
+  }
+
+  PutVarint(out, postings_.size());
+  for (const auto& [term, postings] : postings_) {
+    PutVarint(out, term.size());
+    out.append(term);
+    PutVarint(out, postings.size());
+    previous = 0;
+    for (const auto& posting : postings) {
+      PutVarint(out, posting.message_id - previous);
+      PutVarint(out, posting.frequency);
+      previous = posting.message_id;
+    }
+  }
+
+  // Write to the side and rename, so a crash never leaves a half-written
+  // index behind. It holds the text of every message, so like the cache it
+  // is only ever readable by the owner.
+  auto temporary = path_;
+  temporary += ".tmp";
+  std::error_code error;
+  const int file_descriptor =
+      ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+             FILE_MODE);
+  if (file_descriptor < 0) {
+    SPDLOG_ERROR("Could not write search index {}: {}", temporary.string(),
+                 std::strerror(errno));
+    return;
+  }
+  // In case it already existed with looser permissions
+  ::fchmod(file_descriptor, FILE_MODE);
+  size_t written = 0;
+  while (written < out.size()) {
+    const auto result = ::write(file_descriptor, out.data() + written,
+                                out.size() - written);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      SPDLOG_ERROR("Could not write search index {}: {}", temporary.string(),
+                   std::strerror(errno));
+      ::close(file_descriptor);
+      std::filesystem::remove(temporary, error);
+      return;
+    }
+    written += static_cast<size_t>(result);
+  }
+  ::fsync(file_descriptor);
+  ::close(file_descriptor);
+
+  std::filesystem::rename(temporary, path_, error);
+  if (error) {
+    SPDLOG_ERROR("Could not save search index {}: {}", path_.string(),
+                 error.message());
+    return;
+  }
+  dirty_ = false;
+  SPDLOG_INFO("Saved search index ({} messages, {} bytes)", documents_.size(),
+              out.size());
+}
+
+bool SearchIndex::Load(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  const std::string data{std::istreambuf_iterator<char>(file),
+                         std::istreambuf_iterator<char>()};
+  if (!data.starts_with(INDEX_MAGIC)) {
+    return false;
+  }
+
+  VarintReader reader(std::string_view(data).substr(INDEX_MAGIC.size()));
+  if (reader.Next() != INDEX_VERSION) {
+    return false;
+  }
+
+  const auto document_count = reader.Next();
+  if (!document_count) {
+    return false;
+  }
+  uint64_t message_id = 0;
+  for (uint64_t i = 0; i < *document_count; ++i) {
+    const auto delta = reader.Next();
+    const auto conversation_id = reader.Next();
+    const auto length = reader.Next();
+    if (!delta || !conversation_id || !length) {
+      return false;
+    }
+    message_id += *delta;
+    documents_[message_id] = {.conversation_id = *conversation_id,
+                              .length = static_cast<uint32_t>(*length)};
+    total_length_ += *length;
+  }
+
+  const auto term_count = reader.Next();
+  if (!term_count) {
+    return false;
+  }
+  for (uint64_t i = 0; i < *term_count; ++i) {
+    const auto term_length = reader.Next();
+    if (!term_length) {
+      return false;
+    }
+    const auto term = reader.Bytes(*term_length);
+    const auto posting_count = reader.Next();
+    if (!term || !posting_count) {
+      return false;
+    }
+    auto& postings = postings_[std::string(*term)];
+    postings.reserve(*posting_count);
+    message_id = 0;
+    for (uint64_t j = 0; j < *posting_count; ++j) {
+      const auto delta = reader.Next();
+      const auto frequency = reader.Next();
+      if (!delta || !frequency) {
+        return false;
+      }
+      message_id += *delta;
+      const auto document = documents_.find(message_id);
+      if (document == documents_.end()) {
+        return false;
+      }
+      postings.push_back({.message_id = message_id,
+                          .frequency = static_cast<uint32_t>(*frequency),
+                          .length = document->second.length});
+    }
+  }
+  return true;
+}
+
+void SearchIndex::Add(const MessageRecord& record) {
+  if (Contains(record.id)) {
+    return;
+  }
+
+  auto tokens = Tokenize(record.content);
+  const auto length = static_cast<uint32_t>(tokens.size());
+  documents_[record.id] = {.conversation_id = record.conversation_id,
+                           .length = length};
+  total_length_ += tokens.size();
+  dirty_ = true;
+
+  std::ranges::sort(tokens);
+  for (auto token = tokens.begin(); token != tokens.end();) {
+    const auto next =
+        std::find_if(token, tokens.end(),
+                     [&token](const auto& other) { return other != *token; });
+    const Posting posting{.message_id = record.id,
+                          .frequency = static_cast<uint32_t>(next - token),
+                          .length = length};
+
+    // IDs almost always arrive in order, so this is nearly always an append.
+    auto& postings = postings_[*token];
+    if (postings.empty() || postings.back().message_id < record.id) {
+      postings.push_back(posting);
+    } else {
+      postings.insert(std::ranges::lower_bound(postings, record.id, {},
+                                               &Posting::message_id),
+                      posting);
+    }
+    token = next;
+  }
+}
+
+void SearchIndex::Remove(const MessageRecord& record) {
+  const auto document = documents_.find(record.id);
+  if (document == documents_.end()) {
+    return;
+  }
+  total_length_ -= document->second.length;
+  documents_.erase(document);
+  dirty_ = true;
+
+  auto tokens = Tokenize(record.content);
+  std::ranges::sort(tokens);
+  const auto [first, last] = std::ranges::unique(tokens);
+  tokens.erase(first, last);
+  for (const auto& token : tokens) {
+    const auto postings = postings_.find(token);
+    if (postings == postings_.end()) {
+      continue;
+    }
+    auto& list = postings->second;
+    const auto posting =
+        std::ranges::lower_bound(list, record.id, {}, &Posting::message_id);
+    if (posting != list.end() && posting->message_id == record.id) {
+      list.erase(posting);
+    }
+    if (list.empty()) {
+      postings_.erase(postings);
+    }
+  }
+}
+
+bool SearchIndex::Contains(const uint64_t message_id) const {
+  return documents_.contains(message_id);
+}
+
+std::vector<SearchHit> SearchIndex::Search(const std::string_view query,
+                                           const size_t limit) const {
+  auto terms = Tokenize(query);
+  std::ranges::sort(terms);
+  const auto [first, last] = std::ranges::unique(terms);
+  terms.erase(first, last);
+  if (terms.empty() || documents_.empty()) {
+    return {};
+  }
+
+  // Every term has to match, so start from the rarest one.
+  std::vector<const std::vector<Posting>*> lists;
+  for (const auto& term : terms) {
+    const auto postings = postings_.find(term);
+    if (postings == postings_.end()) {
+      return {};
+    }
+    lists.push_back(&postings->second);
+  }
+  std::ranges::sort(lists, {}, [](const auto* list) { return list->size(); });
+
+  const auto document_count = static_cast<double>(documents_.size());
+  const double average_length =
+      static_cast<double>(total_length_) / document_count;
+  const auto idf = [document_count](const std::vector<Posting>& list) {
+    const auto frequency = static_cast<double>(list.size());
+    return std::log(1.0 + (document_count - frequency + 0.5) /
+                              (frequency + 0.5));
+  };
+  const auto score = [average_length](const Posting& posting,
+                                      const double term_idf) {
+    const auto length = static_cast<double>(posting.length);
+    const auto term_frequency = static_cast<double>(posting.frequency);
+    return term_idf * term_frequency * (BM25_K1 + 1) /
+           (term_frequency +
+            BM25_K1 * (1 - BM25_B + BM25_B * length / average_length));
+  };
+
+  std::vector<SearchHit> hits;
+  hits.reserve(lists.front()->size());
+  const auto first_idf = idf(*lists.front());
+  for (const auto& posting : *lists.front()) {
+    hits.push_back({.message_id = posting.message_id,
+                    .score = score(posting, first_idf)});
+  }
+
+  // Intersect with each longer list, searching forward from the last match.
+  for (size_t i = 1; i < lists.size() && !hits.empty(); ++i) {
+    const auto& list = *lists[i];
+    const auto list_idf = idf(list);
+    auto cursor = list.begin();
+    // Matches are compacted to the front as we go.
+    size_t kept = 0;
+    for (const auto& hit : hits) {
+      cursor = std::lower_bound(
+          cursor, list.end(), hit.message_id,
+          [](const Posting& posting, const uint64_t message_id) {
+            return posting.message_id < message_id;
+          });
+      if (cursor == list.end()) {
+        break;
+      }
+      if (cursor->message_id == hit.message_id) {
+        hits[kept] = hit;
+        hits[kept].score += score(*cursor, list_idf);
+        ++kept;
+      }
+    }
+    hits.resize(kept);
+  }
+
+  // Best score first, and newest first among equals.
+  const auto ranking = [](const SearchHit& lhs, const SearchHit& rhs) {
+    return lhs.score != rhs.score ? lhs.score > rhs.score
+                                  : lhs.message_id > rhs.message_id;
+  };
+  const auto count = std::min(limit, hits.size());
+  std::partial_sort(hits.begin(), hits.begin() + static_cast<long>(count),
+                    hits.end(), ranking);
+  hits.resize(count);
+  for (auto& hit : hits) {
+    hit.conversation_id = documents_.at(hit.message_id).conversation_id;
+  }
+  return hits;
+}
+
+}  // namespace discord_social_tui
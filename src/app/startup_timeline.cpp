@@ -0,0 +1,127 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/startup_timeline.hpp"
+
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "app/stats.hpp"
+
+namespace discord_social_tui {
+
+namespace {
+
+constexpr std::string_view MilestoneName(
+    const StartupTimeline::Milestone milestone) {
+  switch (milestone) {
+    case StartupTimeline::Milestone::FirstFrame:
+      return "first frame";
+    case StartupTimeline::Milestone::Ready:
+      return "ready";
+    case StartupTimeline::Milestone::Interactive:
+      return "interactive";
+  }
+  return "";
+}
+
+std::string FormatMilestone(
+    const std::optional<StartupTimeline::Clock::duration>& elapsed) {
+  return elapsed ? FormatDuration(*elapsed) : "not reached";
+}
+
+}  // namespace
+
+StartupTimeline::Scope::Scope(StartupTimeline& timeline, std::string name)
+    : timeline_(timeline), name_(std::move(name)) {
+  timeline_.Begin(name_);
+}
+
+StartupTimeline::Scope::~Scope() { timeline_.End(name_); }
+
+StartupTimeline::StartupTimeline(const Clock::time_point started)
+    : started_(started) {}
+
+void StartupTimeline::Begin(const std::string_view name) {
+  const auto now = Clock::now() - started_;
+  const std::scoped_lock lock(mutex_);
+  if (std::ranges::find(phases_, name, &Phase::name) == phases_.end()) {
+    phases_.push_back(
+        {.name = std::string(name), .begin = now, .end = std::nullopt});
+  }
+}
+
+void StartupTimeline::End(const std::string_view name) {
+  const auto now = Clock::now() - started_;
+  const std::scoped_lock lock(mutex_);
+  const auto phase = std::ranges::find(phases_, name, &Phase::name);
+  if (phase == phases_.end() || phase->end) {
+    return;
+  }
+  phase->end = now;
+  SPDLOG_DEBUG("Startup phase {} took {}", name,
+               FormatDuration(now - phase->begin));
+}
+
+StartupTimeline::Scope StartupTimeline::Measure(std::string name) {
+  return {*this, std::move(name)};
+}
+
+void StartupTimeline::Mark(const Milestone milestone) {
+  const auto now = Clock::now() - started_;
+  const std::scoped_lock lock(mutex_);
+  auto& elapsed = milestones_.at(static_cast<size_t>(milestone));
+  if (!elapsed) {
+    elapsed = now;
+  }
+}
+
+std::optional<StartupTimeline::Clock::duration> StartupTimeline::Elapsed(
+    const Milestone milestone) const {
+  const std::scoped_lock lock(mutex_);
+  return milestones_.at(static_cast<size_t>(milestone));
+}
+
+std::string StartupTimeline::Summary() const {
+  return fmt::format("time to first frame {}, time to interactive {}",
+                     FormatMilestone(Elapsed(Milestone::FirstFrame)),
+                     FormatMilestone(Elapsed(Milestone::Interactive)));
+}
+
+std::string StartupTimeline::Report() const {
+  const std::scoped_lock lock(mutex_);
+  auto phases = phases_;
+  std::ranges::stable_sort(phases, {}, &Phase::begin);
+
+  // Phases that overlap are easy to spot by their start times.
+  std::string report = "Startup phases (start, duration):\n";
+  for (const auto& phase : phases) {
+    report += fmt::format(
+        "  {:<20} {:>10} {:>10}\n", phase.name, FormatDuration(phase.begin),
+        phase.end ? FormatDuration(*phase.end - phase.begin) : "unfinished");
+  }
+  report += "Milestones:\n";
+  for (const auto milestone :
+       {Milestone::FirstFrame, Milestone::Ready, Milestone::Interactive}) {
+    report += fmt::format(
+        "  {:<20} {:>10}\n", MilestoneName(milestone),
+        FormatMilestone(milestones_.at(static_cast<size_t>(milestone))));
+  }
+  return report;
+}
+
+}  // namespace discord_social_tui
@@ -0,0 +1,78 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/stats.hpp"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace discord_social_tui {
+
+void LatencyStats::Record(const std::chrono::nanoseconds sample) {
+  if (samples_.size() < MAX_SAMPLES) {
+    samples_.push_back(sample);
+  } else {
+    samples_[next_] = sample;
+  }
+  next_ = (next_ + 1) % MAX_SAMPLES;
+  ++count_;
+}
+
+std::chrono::nanoseconds LatencyStats::Percentile(
+    const double percentile) const {
+  if (samples_.empty()) {
+    return std::chrono::nanoseconds::zero();
+  }
+  auto sorted = samples_;
+  const auto rank = static_cast<size_t>(
+      std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 *
+                static_cast<double>(sorted.size())));
+  const auto index = rank == 0 ? 0 : rank - 1;
+  std::ranges::nth_element(sorted, sorted.begin() + static_cast<long>(index));
+  return sorted[index];
+}
+
+std::chrono::nanoseconds LatencyStats::Max() const {
+  if (samples_.empty()) {
+    return std::chrono::nanoseconds::zero();
+  }
+  return std::ranges::max(samples_);
+}
+
+std::string LatencyStats::Summary() const {
+  constexpr double P50 = 50;
+  constexpr double P99 = 99;
+  return fmt::format("n={} p50={} p99={} max={}", count_,
+                     FormatDuration(Percentile(P50)),
+                     FormatDuration(Percentile(P99)), FormatDuration(Max()));
+}
+
+std::string FormatDuration(const std::chrono::nanoseconds duration) {
+  constexpr double THOUSAND = 1000.0;
+  const auto nanoseconds = static_cast<double>(duration.count());
+  if (nanoseconds < THOUSAND) {
+    return fmt::format("{}ns", duration.count());
+  }
+  if (nanoseconds < THOUSAND * THOUSAND) {
+    return fmt::format("{:.0f}us", nanoseconds / THOUSAND);
+  }
+  if (nanoseconds < THOUSAND * THOUSAND * THOUSAND) {
+    return fmt::format("{:.1f}ms", nanoseconds / (THOUSAND * THOUSAND));
+  }
+  return fmt::format("{:.1f}s", nanoseconds / (THOUSAND * THOUSAND * THOUSAND));
+}
+
+}  // namespace discord_social_tui
@@ -0,0 +1,143 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/text_layout.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "ftxui/screen/string.hpp"
+
+namespace discord_social_tui {
+
+namespace {
+
+struct Glyph {
+  std::string text;
+  int width = 0;
+  uint32_t style = 0;
+};
+
+// Adds glyphs to a line, joining them onto the last run while the style
+// stays the same.
+class LineBuilder {
+ public:
+  void Append(const Glyph& glyph) {
+    if (line_.empty() || line_.back().style != glyph.style) {
+      line_.push_back({.text = {}, .style = glyph.style});
+    }
+    line_.back().text += glyph.text;
+    width_ += glyph.width;
+  }
+
+  [[nodiscard]] bool empty() const { return line_.empty(); }
+  [[nodiscard]] int width() const { return width_; }
+
+  StyledLine Take() {
+    width_ = 0;
+    return std::exchange(line_, {});
+  }
+
+ private:
+  StyledLine line_;
+  int width_ = 0;
+};
+
+}  // namespace
+
+std::vector<std::string> WrapText(const std::string_view text,
+                                  const int first_width, const int width) {
+  const StyledRun run{.text = std::string(text)};
+  std::vector<std::string> lines;
+  for (const auto& line : WrapRuns({&run, 1}, first_width, width)) {
+    lines.emplace_back(line.empty() ? "" : line.front().text);
+  }
+  return lines;
+}
+
+std::vector<StyledLine> WrapRuns(const std::span<const StyledRun> runs,
+                                 const int first_width, const int width) {
+  std::vector<StyledLine> lines;
+  LineBuilder line;
+  int limit = std::max(first_width, 1);
+
+  const auto flush = [&] {
+    lines.push_back(line.Take());
+    limit = std::max(width, 1);
+  };
+
+  std::vector<Glyph> word;
+  int word_width = 0;
+  // The space in front of the word being built, if there was one
+  std::optional<Glyph> space;
+  const auto place_word = [&] {
+    if (word.empty()) {
+      return;
+    }
+    const auto gap = line.empty() ? 0 : 1;
+    if (line.width() + gap + word_width <= limit) {
+      if (gap != 0) {
+        line.Append(*space);
+      }
+    } else if (!line.empty()) {
+      flush();
+    }
+    // Too long for any line, so break it wherever it runs out of room.
+    for (const auto& glyph : word) {
+      if (line.width() + glyph.width > limit && !line.empty()) {
+        flush();
+      }
+      line.Append(glyph);
+    }
+    word.clear();
+    word_width = 0;
+    space.reset();
+  };
+
+  for (const auto& run : runs) {
+    // Glyphs leave out control characters, so newlines are found first.
+    std::string_view rest = run.text;
+    while (true) {
+      const auto newline = rest.find('\n');
+      const std::string paragraph(rest.substr(0, newline));
+      for (auto& text : ftxui::Utf8ToGlyphs(paragraph)) {
+        if (text == " ") {
+          place_word();
+          if (!space && !line.empty()) {
+            space = Glyph{.text = " ", .width = 1, .style = run.style};
+          }
+          continue;
+        }
+        const auto glyph_width = ftxui::string_width(text);
+        word.push_back({.text = std::move(text),
+                        .width = glyph_width,
+                        .style = run.style});
+        word_width += glyph_width;
+      }
+      if (newline == std::string_view::npos) {
+        break;
+      }
+      place_word();
+      flush();
+      rest.remove_prefix(newline + 1);
+    }
+  }
+  place_word();
+  flush();
+  return lines;
+}
+
+}  // namespace discord_social_tui
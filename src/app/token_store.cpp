@@ -0,0 +1,167 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/token_store.hpp"
+
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+namespace discord_social_tui {
+
+namespace {
+
+// One value per line, after a magic line that carries the format version.
+constexpr std::string_view TOKEN_MAGIC = "discord-social-tui-token 1";
+
+constexpr mode_t FILE_MODE = S_IRUSR | S_IWUSR;
+
+template <typename T>
+std::optional<T> ParseNumber(const std::string_view text) {
+  T value{};
+  const auto [ptr, error] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (error != std::errc{} || ptr != text.data() + text.size()) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+}  // namespace
+
+bool StoredToken::ExpiresWithin(const std::chrono::seconds margin) const {
+  return std::chrono::system_clock::now() + margin >= expires_at;
+}
+
+TokenStore::TokenStore(std::filesystem::path path) : path_(std::move(path)) {}
+
+std::optional<StoredToken> TokenStore::Load() const {
+  struct stat status{};
+  if (::stat(path_.c_str(), &status) != 0) {
+    return std::nullopt;
+  }
+  // Someone else may have been able to read it, so stop that from now on.
+  if ((status.st_mode & (S_IRWXG | S_IRWXO)) != 0) {
+    SPDLOG_WARN("Token file {} was readable by others, restricting it",
+                path_.string());
+    ::chmod(path_.c_str(), FILE_MODE);
+  }
+
+  std::ifstream file(path_);
+  std::string magic;
+  std::string token_type;
+  std::string expires_at;
+  StoredToken token;
+  if (!std::getline(file, magic) || magic != TOKEN_MAGIC ||
+      !std::getline(file, token_type) || !std::getline(file, expires_at) ||
+      !std::getline(file, token.access_token) ||
+      !std::getline(file, token.refresh_token)) {
+    SPDLOG_WARN("Ignoring unreadable token file {}", path_.string());
+    return std::nullopt;
+  }
+
+  const auto type = ParseNumber<int>(token_type);
+  const auto expires = ParseNumber<int64_t>(expires_at);
+  if (!type || !expires || token.access_token.empty()) {
+    SPDLOG_WARN("Ignoring unreadable token file {}", path_.string());
+    return std::nullopt;
+  }
+  token.token_type = static_cast<discordpp::AuthorizationTokenType>(*type);
+  token.expires_at =
+      std::chrono::system_clock::time_point(std::chrono::seconds(*expires));
+  return token;
+}
+
+bool TokenStore::Save(const StoredToken& token) const {
+  std::error_code error;
+  const auto directory = path_.parent_path();
+  std::filesystem::create_directories(directory, error);
+  if (error) {
+    SPDLOG_ERROR("Could not create {}: {}", directory.string(),
+                 error.message());
+    return false;
+  }
+  std::filesystem::permissions(directory, std::filesystem::perms::owner_all,
+                               error);
+
+  const auto expires_at = std::chrono::duration_cast<std::chrono::seconds>(
+                              token.expires_at.time_since_epoch())
+                              .count();
+  std::string contents(TOKEN_MAGIC);
+  contents += '\n';
+  contents += std::to_string(static_cast<int>(token.token_type)) + '\n';
+  contents += std::to_string(expires_at) + '\n';
+  contents += token.access_token + '\n';
+  contents += token.refresh_token + '\n';
+
+  // Created with owner-only permissions, so the tokens are never readable
+  // by anyone else, even briefly, then renamed over the old file.
+  auto temporary = path_;
+  temporary += ".tmp";
+  const int file_descriptor =
+      ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+             FILE_MODE);
+  if (file_descriptor < 0) {
+    SPDLOG_ERROR("Could not save tokens to {}: {}", temporary.string(),
+                 std::strerror(errno));
+    return false;
+  }
+  // In case it already existed with looser permissions
+  ::fchmod(file_descriptor, FILE_MODE);
+
+  size_t written = 0;
+  while (written < contents.size()) {
+    const auto result = ::write(file_descriptor, contents.data() + written,
+                                contents.size() - written);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      SPDLOG_ERROR("Could not save tokens to {}: {}", temporary.string(),
+                   std::strerror(errno));
+      ::close(file_descriptor);
+      std::filesystem::remove(temporary, error);
+      return false;
+    }
+    written += static_cast<size_t>(result);
+  }
+  ::fsync(file_descriptor);
+  ::close(file_descriptor);
+
+  std::filesystem::rename(temporary, path_, error);
+  if (error) {
+    SPDLOG_ERROR("Could not save tokens to {}: {}", path_.string(),
+                 error.message());
+    std::filesystem::remove(temporary, error);
+    return false;
+  }
+  SPDLOG_DEBUG("Saved tokens to {}", path_.string());
+  return true;
+}
+
+void TokenStore::Clear() const {
+  std::error_code error;
+  std::filesystem::remove(path_, error);
+}
+
+}  // namespace discord_social_tui
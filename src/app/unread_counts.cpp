@@ -0,0 +1,147 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "app/unread_counts.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace discord_social_tui {
+
+UnreadCounts::UnreadCounts() : entries_(INITIAL_CAPACITY) {}
+
+bool UnreadCounts::Add(const uint64_t conversation_id,
+                       const uint64_t message_id) {
+  auto& entry = FindOrInsert(conversation_id);
+  // The last-read marker never passes the newest message, so this also
+  // skips anything already read.
+  if (message_id <= entry.newest) {
+    return false;
+  }
+  entry.newest = message_id;
+  ++entry.count;
+  ++total_;
+  return true;
+}
+
+bool UnreadCounts::Remove(const uint64_t conversation_id,
+                          const uint64_t message_id) {
+  auto& entry = entries_[Probe(conversation_id)];
+  if (entry.conversation_id == 0 || entry.count == 0 ||
+      message_id <= entry.last_read || message_id > entry.newest) {
+    return false;
+  }
+  --entry.count;
+  --total_;
+  return true;
+}
+
+bool UnreadCounts::MarkRead(const uint64_t conversation_id) {
+  auto& entry = entries_[Probe(conversation_id)];
+  // Don't add an entry just to say there's nothing unread.
+  if (entry.conversation_id == 0) {
+    return false;
+  }
+  entry.last_read = std::max(entry.last_read, entry.newest);
+  if (entry.count == 0) {
+    return false;
+  }
+  total_ -= entry.count;
+  entry.count = 0;
+  return true;
+}
+
+bool UnreadCounts::Restore(const uint64_t conversation_id,
+                           const uint32_t count) {
+  if (count == 0) {
+    return false;
+  }
+  auto& entry = FindOrInsert(conversation_id);
+  if (entry.count != 0) {
+    return false;
+  }
+  entry.count = count;
+  total_ += count;
+  return true;
+}
+
+uint32_t UnreadCounts::Count(const uint64_t conversation_id) const {
+  const auto* entry = Find(conversation_id);
+  return entry == nullptr ? 0 : entry->count;
+}
+
+uint64_t UnreadCounts::LastRead(const uint64_t conversation_id) const {
+  const auto* entry = Find(conversation_id);
+  return entry == nullptr ? 0 : entry->last_read;
+}
+
+std::vector<uint64_t> UnreadCounts::Conversations() const {
+  std::vector<uint64_t> conversations;
+  if (total_ == 0) {
+    return conversations;
+  }
+  for (const auto& entry : entries_) {
+    if (entry.count > 0) {
+      conversations.push_back(entry.conversation_id);
+    }
+  }
+  return conversations;
+}
+
+const UnreadCounts::Entry* UnreadCounts::Find(
+    const uint64_t conversation_id) const {
+  const auto& entry = entries_[Probe(conversation_id)];
+  return entry.conversation_id == 0 ? nullptr : &entry;
+}
+
+UnreadCounts::Entry& UnreadCounts::FindOrInsert(
+    const uint64_t conversation_id) {
+  if ((used_ + 1) * 2 > entries_.size()) {
+    Grow();
+  }
+  auto& entry = entries_[Probe(conversation_id)];
+  if (entry.conversation_id == 0) {
+    entry.conversation_id = conversation_id;
+    ++used_;
+  }
+  return entry;
+}
+
+size_t UnreadCounts::Probe(const uint64_t conversation_id) const {
+  // Snowflake IDs share their high bits, so mix them before masking.
+  constexpr uint64_t MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+  constexpr unsigned SHIFT = 32;
+  const auto hash = conversation_id * MULTIPLIER;
+  const auto mask = entries_.size() - 1;
+  auto slot = static_cast<size_t>(hash ^ (hash >> SHIFT)) & mask;
+  // The table is never full, so this always finds the entry or a gap.
+  while (entries_[slot].conversation_id != conversation_id &&
+         entries_[slot].conversation_id != 0) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+void UnreadCounts::Grow() {
+  auto previous = std::exchange(entries_,
+                                std::vector<Entry>(entries_.size() * 2));
+  used_ = 0;
+  for (const auto& entry : previous) {
+    if (entry.conversation_id != 0) {
+      FindOrInsert(entry.conversation_id) = entry;
+    }
+  }
+}
+
+}  // namespace discord_social_tui
@@ -37,9 +37,9 @@ void Voice::Call() {
   }
 
   const auto& friend_ = selected_friend.value();
-  const std::string lobby_secret = VOICE_CALL_PREFIX +
-                                   current_user->Username() + ":" +
-                                   friend_->GetUsername();
+  const std::string lobby_secret =
+      (VOICE_CALL_PREFIX + current_user->Username() + ":")
+          .append(friend_->GetUsername());
 
   SPDLOG_INFO("Invoking Voice::Call! {}", lobby_secret);
 
@@ -13,20 +13,26 @@
 // limitations under the License.
 
 #define DISCORDPP_IMPLEMENTATION
+#include <spdlog/async.h>
 #include <spdlog/cfg/env.h>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <charconv>
+#include <chrono>
 #include <cstdlib>
 #include <iostream>
 #include <optional>
-#include <ranges>
-#include <regex>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <vector>
 
 #include "app/app.hpp"
+#include "app/binary_log.hpp"
+#include "app/json_escape.hpp"
+#include "app/startup_timeline.hpp"
 #include "discordpp.h"
 
 // Get environment variable
@@ -94,12 +100,123 @@ std::string ParseLogFileName(const std::vector<std::string>& args) {
   return log_file_name;
 }
 
+// Parse how many seconds a conversation can go unviewed before it is
+// compressed in memory. Zero turns compression off.
+std::optional<std::chrono::seconds> ParseCompressAfter(
+    const std::vector<std::string>& args) {
+  static constexpr size_t PREFIX_LENGTH = 17;  // Length of "--compress-after="
+  static constexpr std::chrono::seconds DEFAULT_COMPRESS_AFTER{600};
+
+  // Format: --compress-after=SECONDS
+  for (size_t i = 1; i < args.size(); ++i) {
+    const std::string& arg = args[i];
+
+    if (arg.starts_with("--compress-after=")) {
+      const auto value = std::string_view(arg).substr(PREFIX_LENGTH);
+      int64_t seconds = 0;
+      if (const auto [ptr, error] = std::from_chars(
+              value.data(), value.data() + value.size(), seconds);
+          error != std::errc{} || ptr != value.data() + value.size() ||
+          seconds < 0) {
+        std::cerr << "Error: --compress-after expects a number of seconds"
+                  << '\n';
+        return std::nullopt;
+      }
+      return std::chrono::seconds(seconds);
+    }
+  }
+
+  return DEFAULT_COMPRESS_AFTER;
+}
+
+// How log messages get to the log file
+enum class LogMode {
+  // Written on the calling thread
+  Sync,
+  // Queued for a background thread, waiting for space when the queue is full
+  Block,
+  // Queued, replacing the oldest queued message when full
+  DropOldest,
+  // Queued, discarding the new message when full
+  Drop,
+};
+
+// Parse the log mode from command line arguments
+std::optional<LogMode> ParseLogMode(const std::vector<std::string>& args) {
+  static constexpr size_t PREFIX_LENGTH = 11;  // Length of "--log-mode="
+
+  // Format: --log-mode=MODE
+  for (size_t i = 1; i < args.size(); ++i) {
+    const std::string& arg = args[i];
+
+    if (arg.starts_with("--log-mode=")) {
+      const auto value = std::string_view(arg).substr(PREFIX_LENGTH);
+      if (value == "sync") {
+        return LogMode::Sync;
+      }
+      if (value == "block") {
+        return LogMode::Block;
+      }
+      if (value == "drop-oldest") {
+        return LogMode::DropOldest;
+      }
+      if (value == "drop") {
+        return LogMode::Drop;
+      }
+      std::cerr << "Error: --log-mode expects sync, block, drop-oldest or drop"
+                << '\n';
+      return std::nullopt;
+    }
+  }
+
+  return LogMode::Block;
+}
+
+// What the log file is written as
+enum class LogFormat {
+  // A line of JSON per message
+  Json,
+  // Compact binary records in rotating, compressed segments
+  Binary,
+};
+
+// Parse the log format from command line arguments
+std::optional<LogFormat> ParseLogFormat(const std::vector<std::string>& args) {
+  static constexpr size_t PREFIX_LENGTH = 13;  // Length of "--log-format="
+
+  // Format: --log-format=FORMAT
+  for (size_t i = 1; i < args.size(); ++i) {
+    const std::string& arg = args[i];
+
+    if (arg.starts_with("--log-format=")) {
+      const auto value = std::string_view(arg).substr(PREFIX_LENGTH);
+      if (value == "json") {
+        return LogFormat::Json;
+      }
+      if (value == "binary") {
+        return LogFormat::Binary;
+      }
+      std::cerr << "Error: --log-format expects json or binary" << '\n';
+      return std::nullopt;
+    }
+  }
+
+  return LogFormat::Json;
+}
+
+// Whether to print where startup time went once the app exits
+bool ParseStartupReport(const std::vector<std::string>& args) {
+  return std::ranges::find(args, "--startup-report") != args.end();
+}
+
 // Show usage information
 void PrintUsage(const std::string& program_name) {
   std::cerr << "Usage: " << program_name << " --application-id=YOUR_APP_ID"
-            << " [--log-file=FILE_NAME]" << '\n';
+            << " [--log-file=FILE_NAME] [--log-mode=MODE]"
+            << " [--log-format=FORMAT]"
+            << " [--compress-after=SECONDS] [--startup-report]" << '\n';
   std::cerr << "   or: " << program_name << " -a YOUR_APP_ID"
-            << " [-l FILE_NAME]" << '\n';
+            << " [-l FILE_NAME] [--compress-after=SECONDS]" << '\n';
   std::cerr << '\n';
   std::cerr << "Options:" << '\n';
   std::cerr
@@ -107,21 +224,62 @@ void PrintUsage(const std::string& program_name) {
       << '\n';
   std::cerr << "   --log-file, -l        <FILE>  Log file name (default: 'log')"
             << '\n';
+  std::cerr << "   --log-mode            <MODE>  sync, or queue for a "
+               "background writer and when full: block (default),"
+            << '\n';
+  std::cerr << "                                 drop-oldest or drop"
+            << '\n';
+  std::cerr << "   --log-format          <FMT>   json (default), or binary "
+               "segments read with discord_social_tui_log_decode"
+            << '\n';
+  std::cerr << "   --compress-after      <SECS>  Compress conversations idle "
+               "this long (default: 600, 0 to disable)"
+            << '\n';
+  std::cerr << "   --startup-report              Print startup phase timings "
+               "on exit"
+            << '\n';
   std::cerr << '\n';
   std::cerr << "Environment Variables:" << '\n';
   std::cerr << "   DISCORD_APPLICATION_ID: Discord application ID" << '\n';
 }
 
-bool ConfigureLogger(const std::string& log_file_name) {
+bool ConfigureLogger(const std::string& log_file_name, const LogMode mode,
+                     const LogFormat format) {
   constexpr int FLUSH_INTERVAL = 2;
+  // Binary logs start a new segment at this size, keeping the newest few.
+  constexpr size_t SEGMENT_SIZE = 4 * 1024 * 1024;
+  constexpr size_t MAX_SEGMENTS = 16;
+  // Messages waiting for the writer thread. Bounded, so a burst can't eat
+  // memory, and large enough that the UI thread shouldn't have to wait.
+  constexpr size_t QUEUE_SIZE = 8192;
 
   try {
     // Create a file sink with the provided file name
-    auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(
-        log_file_name, true);
+    spdlog::sink_ptr file_sink;
+    if (format == LogFormat::Binary) {
+      file_sink = std::make_shared<discord_social_tui::BinaryLogSink>(
+          log_file_name, SEGMENT_SIZE, MAX_SEGMENTS);
+    } else {
+      file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(
+          log_file_name, true);
+    }
 
-    // Create logger with file sink
-    auto logger = std::make_shared<spdlog::logger>("logger", file_sink);
+    // Create logger with file sink. Unless asked not to, formatting and
+    // writing happen on a background thread, off the UI thread.
+    std::shared_ptr<spdlog::logger> logger;
+    if (mode == LogMode::Sync) {
+      logger = std::make_shared<spdlog::logger>("logger", file_sink);
+    } else {
+      spdlog::init_thread_pool(QUEUE_SIZE, 1);
+      auto policy = spdlog::async_overflow_policy::block;
+      if (mode == LogMode::DropOldest) {
+        policy = spdlog::async_overflow_policy::overrun_oldest;
+      } else if (mode == LogMode::Drop) {
+        policy = spdlog::async_overflow_policy::discard_new;
+      }
+      logger = std::make_shared<spdlog::async_logger>(
+          "logger", file_sink, spdlog::thread_pool(), policy);
+    }
 
     // Set as default logger
     spdlog::set_default_logger(logger);
@@ -143,51 +301,52 @@ bool ConfigureLogger(const std::string& log_file_name) {
   }
 }
 
-// Make string safe for JSON by escaping special characters
-std::string MakeJsonSafe(const std::string& input) {
-  std::string result = input;
-
-  // Remove CR and LF
-  result.erase(std::ranges::remove(result, '\n').begin(), result.end());
-  result.erase(std::ranges::remove(result, '\r').begin(), result.end());
-
-  // Replace backslashes with double backslashes
-  result = std::regex_replace(result, std::regex("\\\\"), "\\\\");
-
-  // Replace double quotes with escaped double quotes
-  result = std::regex_replace(result, std::regex("\""), "\\\"");
-
-  // Replace control characters
-  result = std::regex_replace(result, std::regex("\b"), "\\b");
-  result = std::regex_replace(result, std::regex("\f"), "\\f");
-  result = std::regex_replace(result, std::regex("\t"), "\\t");
-
-  return result;
+// Write out everything still queued, and say what didn't make it
+void ShutdownLogger(const LogMode mode) {
+  if (mode != LogMode::Sync) {
+    const auto thread_pool = spdlog::thread_pool();
+    const auto overrun = thread_pool->overrun_counter();
+    const auto discarded = thread_pool->discard_counter();
+    if (overrun > 0 || discarded > 0) {
+      SPDLOG_WARN("Log queue was full, dropped {} log messages",
+                  overrun + discarded);
+    }
+  }
+  spdlog::shutdown();
 }
 
-void StartDiscordLogging(const std::shared_ptr<discordpp::Client>& client) {
+void StartDiscordLogging(const std::shared_ptr<discordpp::Client>& client,
+                         const LogFormat format) {
   client->AddLogCallback(
-      [](const std::string& message,
-         const discordpp::LoggingSeverity severity) {
-        // Make message safe for JSON
-        const std::string json_safe_message = MakeJsonSafe(message);
+      [format](const std::string& message,
+               const discordpp::LoggingSeverity severity) {
+        // The log pattern puts the message in a JSON string. The buffer is
+        // reused, so escaping doesn't allocate once it has grown to fit.
+        // Binary logs are escaped when they are decoded.
+        thread_local std::string json_safe_message;
+        json_safe_message.clear();
+        if (format == LogFormat::Json) {
+          discord_social_tui::AppendJsonEscaped(json_safe_message, message);
+        } else {
+          json_safe_message = message;
+        }
 
         switch (severity) {
           case discordpp::LoggingSeverity::Verbose:
             SPDLOG_LOGGER_CALL(spdlog::default_logger(), spdlog::level::trace,
-                               json_safe_message);
+                               "{}", json_safe_message);
             break;
           case discordpp::LoggingSeverity::Info:
             SPDLOG_LOGGER_CALL(spdlog::default_logger(), spdlog::level::info,
-                               json_safe_message);
+                               "{}", json_safe_message);
             break;
           case discordpp::LoggingSeverity::Warning:
             SPDLOG_LOGGER_CALL(spdlog::default_logger(), spdlog::level::warn,
-                               json_safe_message);
+                               "{}", json_safe_message);
             break;
           case discordpp::LoggingSeverity::Error:
             SPDLOG_LOGGER_CALL(spdlog::default_logger(), spdlog::level::err,
-                               json_safe_message);
+                               "{}", json_safe_message);
             break;
           case discordpp::LoggingSeverity::None:
             break;
@@ -197,16 +356,28 @@ void StartDiscordLogging(const std::shared_ptr<discordpp::Client>& client) {
 }
 
 int main(const int argc, char* argv[]) {
+  // Everything is timed from here
+  const auto timeline =
+      std::make_shared<discord_social_tui::StartupTimeline>();
+
   // Convert C-style arguments to a vector
   const std::vector<std::string> args(argv, argv + argc);
 
   // Parse log file name from command line
   const std::string log_file_name = ParseLogFileName(args);
+  const auto log_mode = ParseLogMode(args);
+  const auto log_format = ParseLogFormat(args);
+  if (!log_mode || !log_format) {
+    PrintUsage(args[0]);
+    return EXIT_FAILURE;
+  }
 
   // Set up logging first with the specified log file name
-  if (!ConfigureLogger(log_file_name)) {
+  timeline->Begin("logger");
+  if (!ConfigureLogger(log_file_name, *log_mode, *log_format)) {
     return EXIT_FAILURE;
   }
+  timeline->End("logger");
 
   // Parse application ID from command line or environment
   const auto application_id = ParseApplicationId(args);
@@ -218,14 +389,37 @@ int main(const int argc, char* argv[]) {
     return EXIT_FAILURE;
   }
 
+  const auto compress_after = ParseCompressAfter(args);
+  if (!compress_after) {
+    PrintUsage(args[0]);
+    return EXIT_FAILURE;
+  }
+
   // Log the application ID
   SPDLOG_INFO("Starting with application ID: {}", *application_id);
 
-  // Create Discord client
-  const auto client = std::make_shared<discordpp::Client>();
-  StartDiscordLogging(client);
+  int result = EXIT_SUCCESS;
+  {
+    // Create Discord client
+    timeline->Begin("client");
+    const auto client = std::make_shared<discordpp::Client>();
+    StartDiscordLogging(client, *log_format);
+    timeline->End("client");
+
+    // Create and run application
+    timeline->Begin("app");
+    discord_social_tui::App app(std::stoull(*application_id), client,
+                                *compress_after, timeline);
+    timeline->End("app");
+    result = app.Run();
+  }
+
+  // Everything that logs is gone, so the queue can be flushed.
+  ShutdownLogger(*log_mode);
 
-  // Create and run application
-  discord_social_tui::App app(std::stoull(*application_id), client);
-  return app.Run();
+  // The terminal is back to normal, so this can't be drawn over.
+  if (ParseStartupReport(args)) {
+    std::cerr << timeline->Report();
+  }
+  return result;
 }
\ No newline at end of file
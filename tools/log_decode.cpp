@@ -0,0 +1,46 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Decodes binary log segments, written with --log-format=binary, into the
+// same JSON lines as the text log.
+//
+// Usage: discord_social_tui_log_decode log.*.bin*
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "app/binary_log.hpp"
+
+int main(const int argc, char* argv[]) {
+  const std::vector<std::string> args(argv, argv + argc);
+  if (args.size() < 2) {
+    std::cerr << "Usage: " << args[0] << " SEGMENT..." << '\n';
+    std::cerr << '\n';
+    std::cerr << "Segments are decoded in the order given. Their names sort "
+                 "oldest first."
+              << '\n';
+    return EXIT_FAILURE;
+  }
+
+  int result = EXIT_SUCCESS;
+  for (size_t i = 1; i < args.size(); ++i) {
+    if (!discord_social_tui::DecodeBinaryLog(args[i], std::cout)) {
+      std::cerr << "Error: could not decode all of " << args[i] << '\n';
+      result = EXIT_FAILURE;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,597 @@
+// Copyright 2025 Mark Mandel
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Runs the app's components through a long simulated session with a large
+// friends list: a steady stream of messages, presence churn, switching
+// conversations, and calls starting and ending. Memory, allocations, frame
+// times and queue depths are sampled as it goes. The run fails if any
+// threshold is exceeded, and a JSON report is written for tracking trends.
+//
+// Usage: discord_social_tui_stress [--duration=SECONDS] [--friends=N] ...
+// (--help for the full list)
+
+#include <spdlog/async.h>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/sinks/basic_file_sink.h>
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "app/buttons.hpp"
+#include "app/friend.hpp"
+#include "app/message_cache.hpp"
+#include "app/message_record.hpp"
+#include "app/messages.hpp"
+#include "app/names.hpp"
+#include "app/prefetcher.hpp"
+#include "app/presence.hpp"
+#include "app/search_index.hpp"
+#include "app/voice.hpp"
+#include "discordpp.h"
+#include "ftxui/component/component.hpp"
+#include "ftxui/dom/elements.hpp"
+#include "ftxui/screen/screen.hpp"
+
+namespace {
+
+// Every allocation made by the process, counted by the operator new below.
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> allocated_bytes{0};
+
+}  // namespace
+
+void* operator new(const std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, std::size_t /*size*/) noexcept {
+  std::free(pointer);
+}
+
+namespace discord_social_tui {
+
+namespace {
+
+// The main loop runs every 10ms, as in App::Run().
+constexpr uint64_t FRAMES_PER_SECOND = 100;
+// The simulated user opens a different conversation this often.
+constexpr uint64_t NAVIGATE_SECONDS = 5;
+constexpr uint64_t OWN_ID = 1;
+constexpr uint64_t FIRST_FRIEND_ID = 1000;
+constexpr uint64_t FIRST_MESSAGE_ID = 1'000'000;
+constexpr int WIDTH = 160;
+constexpr int HEIGHT = 50;
+constexpr int LEFT_WIDTH = 20;
+constexpr uint64_t MIB = 1024 * 1024;
+
+struct Options {
+  // Simulated seconds to run for
+  uint64_t duration = 600;
+  uint64_t friends = 10000;
+  // Messages received per simulated second
+  uint64_t message_rate = 50;
+  // Friends changing status per simulated second
+  uint64_t presence_rate = 20;
+  // Seconds between calls. Each lasts half of this.
+  uint64_t call_interval = 30;
+  // Seconds between samples
+  uint64_t sample_interval = 10;
+
+  // Thresholds, zero turns one off. Memory growth is measured from the
+  // first sample, once the friends list has been built.
+  uint64_t max_rss_growth_mib = 64;
+  uint64_t max_frame_p99_us = 16000;
+  // With every friend's entry drawn, a frame makes tens of thousands.
+  uint64_t max_allocations_per_frame = 100000;
+  uint64_t max_queue_depth = 4096;
+
+  std::string report = "stress_report.json";
+};
+
+struct Flag {
+  std::string_view name;
+  uint64_t Options::* value;
+  std::string_view description;
+};
+
+constexpr std::array FLAGS = {
+    Flag{"duration", &Options::duration, "Simulated seconds to run for"},
+    Flag{"friends", &Options::friends, "Size of the friends list"},
+    Flag{"message-rate", &Options::message_rate,
+         "Messages received per second"},
+    Flag{"presence-rate", &Options::presence_rate,
+         "Friends changing status per second"},
+    Flag{"call-interval", &Options::call_interval,
+         "Seconds between calls, 0 for none"},
+    Flag{"sample-interval", &Options::sample_interval,
+         "Seconds between samples"},
+    Flag{"max-rss-growth-mib", &Options::max_rss_growth_mib,
+         "Fail if resident memory grows more than this"},
+    Flag{"max-frame-p99-us", &Options::max_frame_p99_us,
+         "Fail if the p99 frame time is longer than this"},
+    Flag{"max-allocations-per-frame", &Options::max_allocations_per_frame,
+         "Fail if frames allocate more than this on average"},
+    Flag{"max-queue-depth", &Options::max_queue_depth,
+         "Fail if a queue ever holds more than this"},
+};
+
+void PrintUsage(const std::string& program_name) {
+  std::cerr << "Usage: " << program_name << " [--NAME=VALUE]... [--report=FILE]"
+            << '\n';
+  std::cerr << '\n';
+  std::cerr << "Options:" << '\n';
+  const Options defaults;
+  for (const auto& flag : FLAGS) {
+    std::cerr << fmt::format("   --{:<27} {} (default: {})", flag.name,
+                             flag.description, defaults.*flag.value)
+              << '\n';
+  }
+  std::cerr << fmt::format("   --{:<27} Where to write the report "
+                           "(default: {})",
+                           "report", defaults.report)
+            << '\n';
+  std::cerr << '\n';
+  std::cerr << "Thresholds of 0 are not checked." << '\n';
+}
+
+std::optional<Options> ParseOptions(const std::vector<std::string>& args) {
+  Options options;
+  for (size_t i = 1; i < args.size(); ++i) {
+    const std::string_view arg = args[i];
+    if (arg.starts_with("--report=")) {
+      options.report = arg.substr(std::string_view("--report=").size());
+      continue;
+    }
+
+    const auto flag = std::ranges::find_if(FLAGS, [arg](const Flag& flag) {
+      return arg.starts_with("--") && arg.substr(2).starts_with(flag.name) &&
+             arg.substr(2 + flag.name.size()).starts_with('=');
+    });
+    if (flag == FLAGS.end()) {
+      std::cerr << "Error: unknown option " << arg << '\n';
+      return std::nullopt;
+    }
+    const auto value = arg.substr(3 + flag->name.size());
+    if (const auto [ptr, error] = std::from_chars(
+            value.data(), value.data() + value.size(), options.*flag->value);
+        error != std::errc{} || ptr != value.data() + value.size()) {
+      std::cerr << "Error: --" << flag->name << " expects a number" << '\n';
+      return std::nullopt;
+    }
+  }
+  if (options.friends == 0 || options.sample_interval == 0) {
+    std::cerr << "Error: --friends and --sample-interval can't be 0" << '\n';
+    return std::nullopt;
+  }
+  return options;
+}
+
+size_t ResidentBytes() {
+  std::ifstream statm("/proc/self/statm");
+  size_t size = 0;
+  size_t resident = 0;
+  statm >> size >> resident;
+  return resident * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+// Percentile (0-100) of some frame times.
+std::chrono::nanoseconds Percentile(
+    std::vector<std::chrono::nanoseconds> frame_times,
+    const double percentile) {
+  if (frame_times.empty()) {
+    return {};
+  }
+  const auto index = static_cast<size_t>(
+      percentile / 100.0 * static_cast<double>(frame_times.size() - 1));
+  std::ranges::nth_element(frame_times, frame_times.begin() + index);
+  return frame_times[index];
+}
+
+struct Sample {
+  uint64_t second = 0;
+  size_t resident_bytes = 0;
+  uint64_t allocations = 0;
+  std::chrono::nanoseconds frame_p50{};
+  std::chrono::nanoseconds frame_p99{};
+  std::chrono::nanoseconds frame_max{};
+  size_t incoming_depth = 0;
+  size_t log_depth = 0;
+};
+
+// The components App wires together, driven without a connection. Friends
+// and messages are made from plain data, as the friends snapshot does.
+class Session {
+ public:
+  explicit Session(const Options& options)
+      : options_(options),
+        client_(std::make_shared<discordpp::Client>()),
+        presence_(std::make_shared<Presence>(client_)),
+        voice_(std::make_shared<Voice>(client_, presence_)),
+        cache_(std::make_shared<MessageCache>()),
+        names_(std::make_shared<Names>()),
+        messages_(std::make_shared<Messages>(client_, cache_,
+                                             std::make_shared<SearchIndex>(),
+                                             names_)),
+        friends_(std::make_shared<Friends>(client_, messages_, voice_, names_)),
+        prefetcher_(std::make_unique<Prefetcher>(friends_, messages_)),
+        buttons_(std::make_shared<Buttons>(friends_, voice_)),
+        statuses_(options.friends, discordpp::StatusType::Online),
+        screen_(ftxui::Screen::Create(ftxui::Dimension::Fixed(WIDTH),
+                                      ftxui::Dimension::Fixed(HEIGHT))) {
+    voice_->SetFriends(friends_);
+    messages_->SetFriends(friends_);
+    messages_->SetWidth(WIDTH - LEFT_WIDTH - 1);
+
+    const auto directory =
+        std::filesystem::temp_directory_path() / "discord_social_tui_stress";
+    std::filesystem::remove_all(directory);
+    cache_->Open(directory);
+    messages_->HistoryOpened();
+    // Stand in for the SDK, so messages go through the real ingest path.
+    MessagesTestHook::SetMessageSource(
+        *messages_,
+        [this](const uint64_t message_id) -> std::optional<MessageRecord> {
+          const auto message = sent_.find(message_id);
+          if (message == sent_.end()) {
+            return std::nullopt;
+          }
+          auto record = std::move(message->second);
+          sent_.erase(message);
+          return record;
+        });
+
+    // Start with a mix, as a real list would have.
+    for (size_t i = 0; i < statuses_.size(); ++i) {
+      statuses_[i] = RandomStatus();
+    }
+    RebuildFriends();
+    friends_->SetSelectedIndexByFriendId(FIRST_FRIEND_ID);
+
+    container_ = ftxui::ResizableSplitLeft(
+        friends_->Render(),
+        ftxui::Container::Vertical(
+            {buttons_->GetComponent(), messages_->Render()}),
+        &left_width_);
+  }
+
+  // Run one frame of the main loop at the given point in the session.
+  void Frame(const uint64_t frame) {
+    const auto second = frame / FRAMES_PER_SECOND;
+    const bool new_second = frame % FRAMES_PER_SECOND == 0;
+
+    // Spread each second's events evenly over its frames.
+    const auto due = [frame](const uint64_t per_second) {
+      return ((frame + 1) * per_second / FRAMES_PER_SECOND) -
+             (frame * per_second / FRAMES_PER_SECOND);
+    };
+    for (uint64_t i = due(options_.message_rate); i > 0; --i) {
+      ReceiveMessage();
+    }
+    bool presence_changed = false;
+    for (uint64_t i = due(options_.presence_rate); i > 0; --i) {
+      statuses_[Random(statuses_.size())] = RandomStatus();
+      presence_changed = true;
+    }
+    if (new_second && second % NAVIGATE_SECONDS == 0) {
+      friends_->SetSelectedIndexByFriendId(FIRST_FRIEND_ID +
+                                           Random(statuses_.size()));
+      messages_->ResetSelectedUnreadMessages();
+    }
+    if (new_second && options_.call_interval > 0) {
+      if (second % options_.call_interval == 0) {
+        voice_->Call();
+      } else if (second % options_.call_interval ==
+                 options_.call_interval / 2) {
+        voice_->Disconnect();
+      }
+    }
+
+    incoming_depth_ = std::max(incoming_depth_, messages_->IncomingCount());
+    discordpp::RunCallbacks();
+    // Each relationship update rebuilds the list, as Friends::Refresh does.
+    if (presence_changed) {
+      RebuildFriends();
+    }
+    messages_->Tick();
+    prefetcher_->Tick();
+    ftxui::Render(screen_, container_->Render());
+  }
+
+  // Deepest the incoming message queue has been since the last call.
+  size_t TakeIncomingDepth() { return std::exchange(incoming_depth_, 0); }
+
+ private:
+  const Options& options_;
+  std::shared_ptr<discordpp::Client> client_;
+  std::shared_ptr<Presence> presence_;
+  std::shared_ptr<Voice> voice_;
+  std::shared_ptr<MessageCache> cache_;
+  std::shared_ptr<Names> names_;
+  std::shared_ptr<Messages> messages_;
+  std::shared_ptr<Friends> friends_;
+  std::unique_ptr<Prefetcher> prefetcher_;
+  std::shared_ptr<Buttons> buttons_;
+  std::vector<discordpp::StatusType> statuses_;
+  ftxui::Screen screen_;
+  ftxui::Component container_;
+  int left_width_ = LEFT_WIDTH;
+  // Fixed seed, so runs are comparable
+  std::mt19937_64 random_{1};
+  uint64_t next_message_id_ = FIRST_MESSAGE_ID;
+  size_t incoming_depth_ = 0;
+  // Messages "on the server", until the app looks them up
+  std::unordered_map<uint64_t, MessageRecord> sent_;
+
+  uint64_t Random(const uint64_t bound) {
+    return std::uniform_int_distribution<uint64_t>(0, bound - 1)(random_);
+  }
+
+  discordpp::StatusType RandomStatus() {
+    constexpr std::array STATUSES = {
+        discordpp::StatusType::Online, discordpp::StatusType::Idle,
+        discordpp::StatusType::Dnd, discordpp::StatusType::Offline};
+    return STATUSES.at(Random(STATUSES.size()));
+  }
+
+  void RebuildFriends() {
+    std::vector<std::shared_ptr<Friend>> friends;
+    friends.reserve(statuses_.size());
+    for (size_t i = 0; i < statuses_.size(); ++i) {
+      using Group = discordpp::RelationshipGroupType;
+      const auto group = statuses_[i] == discordpp::StatusType::Offline
+                             ? Group::Offline
+                             : Group::OnlineElsewhere;
+      friends.push_back(std::make_shared<Friend>(
+          FIRST_FRIEND_ID + i, "user" + std::to_string(i),
+          "Friend " + std::to_string(i), statuses_[i], messages_, voice_,
+          names_, group));
+    }
+    friends_->SetFriends(friends);
+  }
+
+  void ReceiveMessage() {
+    // Most conversations are quiet. The chance of a message falls away
+    // geometrically down the list, so nine in ten go to the first 22.
+    constexpr double BUSY_FRIEND_SHARE = 0.1;
+    const auto conversation_id =
+        FIRST_FRIEND_ID +
+        (std::geometric_distribution<uint64_t>(BUSY_FRIEND_SHARE)(random_) %
+         statuses_.size());
+    const bool ours = Random(4) == 0;
+    const auto id = next_message_id_++;
+    sent_.emplace(id, MessageRecord{
+        .id = id,
+        .conversation_id = conversation_id,
+        .author_id = ours ? OWN_ID : conversation_id,
+        .sent_timestamp = id,
+        .author_name = ours ? "me" : "user",
+        .content = "Message " + std::to_string(id) + " " +
+                   std::string(Random(200), 'x') + " with **markup**",
+    });
+    MessagesTestHook::ReceiveMessage(*messages_, id);
+  }
+};
+
+std::string ToJson(const Options& options, const std::vector<Sample>& samples,
+                   const std::vector<std::chrono::nanoseconds>& frame_times,
+                   const std::chrono::nanoseconds wall_time,
+                   const std::vector<std::string>& failures) {
+  std::string json = "{\n  \"options\": {";
+  for (size_t i = 0; i < FLAGS.size(); ++i) {
+    json += fmt::format("{}\"{}\": {}", i == 0 ? "" : ", ", FLAGS.at(i).name,
+                        options.*FLAGS.at(i).value);
+  }
+  json += "},\n";
+
+  const auto& last = samples.back();
+  json += fmt::format(
+      "  \"frames\": {},\n  \"wall_time_ns\": {},\n"
+      "  \"frame_ns\": {{\"p50\": {}, \"p99\": {}, \"max\": {}}},\n"
+      "  \"resident_bytes\": {{\"baseline\": {}, \"end\": {}}},\n"
+      "  \"allocations\": {},\n"
+      "  \"allocated_bytes\": {},\n",
+      frame_times.size(), wall_time.count(),
+      Percentile(frame_times, 50).count(), Percentile(frame_times, 99).count(),
+      std::ranges::max(frame_times).count(), samples.front().resident_bytes,
+      last.resident_bytes, allocations.load(), allocated_bytes.load());
+
+  json += "  \"samples\": [\n";
+  for (size_t i = 0; i < samples.size(); ++i) {
+    const auto& sample = samples[i];
+    json += fmt::format(
+        "    {{\"second\": {}, \"resident_bytes\": {}, \"allocations\": {}, "
+        "\"frame_p50_ns\": {}, \"frame_p99_ns\": {}, \"frame_max_ns\": {}, "
+        "\"incoming_depth\": {}, \"log_depth\": {}}}{}\n",
+        sample.second, sample.resident_bytes, sample.allocations,
+        sample.frame_p50.count(), sample.frame_p99.count(),
+        sample.frame_max.count(), sample.incoming_depth, sample.log_depth,
+        i + 1 < samples.size() ? "," : "");
+  }
+  json += "  ],\n  \"failures\": [";
+  for (size_t i = 0; i < failures.size(); ++i) {
+    json += fmt::format("{}\"{}\"", i == 0 ? "" : ", ", failures[i]);
+  }
+  json += fmt::format("],\n  \"passed\": {}\n}}\n", failures.empty());
+  return json;
+}
+
+// Compare a run against the thresholds, describing each one exceeded.
+std::vector<std::string> CheckThresholds(
+    const Options& options, const std::vector<Sample>& samples,
+    const std::vector<std::chrono::nanoseconds>& frame_times) {
+  std::vector<std::string> failures;
+
+  const auto growth = static_cast<int64_t>(samples.back().resident_bytes) -
+                      static_cast<int64_t>(samples.front().resident_bytes);
+  if (options.max_rss_growth_mib > 0 &&
+      growth > static_cast<int64_t>(options.max_rss_growth_mib * MIB)) {
+    failures.push_back(fmt::format("resident memory grew {} MiB, over {} MiB",
+                                   growth / static_cast<int64_t>(MIB),
+                                   options.max_rss_growth_mib));
+  }
+
+  const auto p99 = std::chrono::duration_cast<std::chrono::microseconds>(
+      Percentile(frame_times, 99));
+  if (options.max_frame_p99_us > 0 &&
+      std::cmp_greater(p99.count(), options.max_frame_p99_us)) {
+    failures.push_back(fmt::format("p99 frame time was {}us, over {}us",
+                                   p99.count(), options.max_frame_p99_us));
+  }
+
+  const auto per_frame = allocations.load() / frame_times.size();
+  if (options.max_allocations_per_frame > 0 &&
+      per_frame > options.max_allocations_per_frame) {
+    failures.push_back(fmt::format("{} allocations per frame, over {}",
+                                   per_frame,
+                                   options.max_allocations_per_frame));
+  }
+
+  const auto depth = std::ranges::max(samples, {}, [](const Sample& sample) {
+    return std::max(sample.incoming_depth, sample.log_depth);
+  });
+  if (options.max_queue_depth > 0 &&
+      std::max(depth.incoming_depth, depth.log_depth) >
+          options.max_queue_depth) {
+    failures.push_back(fmt::format(
+        "a queue held {} entries at {}s, over {}",
+        std::max(depth.incoming_depth, depth.log_depth), depth.second,
+        options.max_queue_depth));
+  }
+  return failures;
+}
+
+int Run(const Options& options) {
+  Session session(options);
+
+  const auto total_frames = options.duration * FRAMES_PER_SECOND;
+  const auto sample_frames = options.sample_interval * FRAMES_PER_SECOND;
+  std::vector<std::chrono::nanoseconds> frame_times;
+  // Reserved up front, so recording doesn't show up as growth.
+  frame_times.reserve(total_frames);
+  std::vector<Sample> samples;
+  samples.reserve((total_frames / sample_frames) + 1);
+
+  const auto started = std::chrono::steady_clock::now();
+  uint64_t sampled_allocations = allocations.load();
+  for (uint64_t frame = 0; frame < total_frames; ++frame) {
+    const auto frame_started = std::chrono::steady_clock::now();
+    session.Frame(frame);
+    frame_times.push_back(std::chrono::steady_clock::now() - frame_started);
+
+    if ((frame + 1) % sample_frames == 0 || frame + 1 == total_frames) {
+      const auto window_start =
+          frame_times.end() -
+          static_cast<std::ptrdiff_t>(std::min<uint64_t>(
+              frame_times.size(), sample_frames));
+      const std::vector window(window_start, frame_times.end());
+      const auto total = allocations.load();
+      samples.push_back({
+          .second = (frame + 1) / FRAMES_PER_SECOND,
+          .resident_bytes = ResidentBytes(),
+          .allocations = total - sampled_allocations,
+          .frame_p50 = Percentile(window, 50),
+          .frame_p99 = Percentile(window, 99),
+          .frame_max = std::ranges::max(window),
+          .incoming_depth = session.TakeIncomingDepth(),
+          .log_depth = spdlog::thread_pool()->queue_size(),
+      });
+      sampled_allocations = total;
+      const auto& sample = samples.back();
+      std::cerr << fmt::format(
+                       "{:>6}s  rss {:>5} MiB  p50 {:>8}ns  p99 {:>9}ns  "
+                       "{:>8} allocations",
+                       sample.second, sample.resident_bytes / MIB,
+                       sample.frame_p50.count(), sample.frame_p99.count(),
+                       sample.allocations)
+                << '\n';
+    }
+  }
+  const auto wall_time = std::chrono::steady_clock::now() - started;
+
+  if (samples.empty()) {
+    std::cerr << "Error: nothing ran, --duration is 0" << '\n';
+    return EXIT_FAILURE;
+  }
+  const auto failures = CheckThresholds(options, samples, frame_times);
+  std::ofstream report(options.report);
+  report << ToJson(options, samples, frame_times, wall_time, failures);
+  if (!report) {
+    std::cerr << "Error: could not write " << options.report << '\n';
+    return EXIT_FAILURE;
+  }
+
+  for (const auto& failure : failures) {
+    std::cerr << "FAILED: " << failure << '\n';
+  }
+  std::cerr << (failures.empty() ? "Passed" : "Failed")
+            << ", report written to " << options.report << '\n';
+  return failures.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}  // namespace
+
+}  // namespace discord_social_tui
+
+int main(const int argc, char* argv[]) {
+  constexpr size_t QUEUE_SIZE = 8192;
+
+  const std::vector<std::string> args(argv, argv + argc);
+  if (std::ranges::find(args, "--help") != args.end()) {
+    discord_social_tui::PrintUsage(args[0]);
+    return EXIT_SUCCESS;
+  }
+  const auto options = discord_social_tui::ParseOptions(args);
+  if (!options) {
+    discord_social_tui::PrintUsage(args[0]);
+    return EXIT_FAILURE;
+  }
+
+  // Log as the app does, so its cost and queue are part of the run.
+  spdlog::init_thread_pool(QUEUE_SIZE, 1);
+  spdlog::set_default_logger(std::make_shared<spdlog::async_logger>(
+      "logger",
+      std::make_shared<spdlog::sinks::basic_file_sink_mt>("stress.log", true),
+      spdlog::thread_pool()));
+
+  const auto result = discord_social_tui::Run(*options);
+  spdlog::shutdown();
+  return result;
+}